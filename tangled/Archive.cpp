@@ -0,0 +1,91 @@
+#include "Archive.h"
+#include <cstring>
+#include <ctime>
+#include <iostream>
+using namespace std;
+#define RECORD_SIZE 512
+#define NAME_OFFSET 0
+#define NAME_SIZE 100
+#define MODE_OFFSET 100
+#define UID_OFFSET 108
+#define GID_OFFSET 116
+#define ID_SIZE 8
+#define SIZE_OFFSET 124
+#define SIZE_SIZE 12
+#define MTIME_OFFSET 136
+#define MTIME_SIZE 12
+#define CHECKSUM_OFFSET 148
+#define CHECKSUM_SIZE 8
+#define TYPE_OFFSET 156
+#define MAGIC_OFFSET 257
+#define PREFIX_OFFSET 345
+#define PREFIX_SIZE 155
+
+Archive::Archive(ostream& output) :
+  stream(output)
+{
+}
+
+bool Archive::addFile(string name, const string& contents, bool executable)
+{
+  char header[RECORD_SIZE];
+  memset(header, 0, sizeof(header));
+  string prefix;
+  if (name.size() > NAME_SIZE)
+  {
+    size_t index = name.rfind("/", PREFIX_SIZE);
+    while ((index != string::npos) && (name.size() - index - 1 > NAME_SIZE))
+    {
+      index = (index == 0) ? string::npos : name.rfind("/", index - 1);
+    }
+    if ((index == string::npos) || (index == 0))
+    {
+      cout << "Error: File name \"" << name << "\" is too long to archive." <<
+        endl;
+      return false;
+    }
+    prefix = name.substr(0, index);
+    name = name.substr(index + 1);
+  }
+  memcpy(header + NAME_OFFSET, name.data(), name.size());
+  memcpy(header + PREFIX_OFFSET, prefix.data(), prefix.size());
+  writeOctal(header + MODE_OFFSET, ID_SIZE, executable ? 0755 : 0644);
+  writeOctal(header + UID_OFFSET, ID_SIZE, 0);
+  writeOctal(header + GID_OFFSET, ID_SIZE, 0);
+  writeOctal(header + SIZE_OFFSET, SIZE_SIZE, contents.size());
+  writeOctal(header + MTIME_OFFSET, MTIME_SIZE, time(nullptr));
+  header[TYPE_OFFSET] = '0';
+  memcpy(header + MAGIC_OFFSET, "ustar\0" "00", 8);
+  memset(header + CHECKSUM_OFFSET, ' ', CHECKSUM_SIZE);
+  uint32_t checksum = 0;
+  for (size_t index = 0; index < sizeof(header); ++index)
+  {
+    checksum += static_cast<unsigned char>(header[index]);
+  }
+  writeOctal(header + CHECKSUM_OFFSET, CHECKSUM_SIZE - 1, checksum);
+  stream.write(header, sizeof(header));
+  stream.write(contents.data(), contents.size());
+  size_t remainder = contents.size() % RECORD_SIZE;
+  if (remainder != 0)
+  {
+    string padding(RECORD_SIZE - remainder, '\0');
+    stream.write(padding.data(), padding.size());
+  }
+  return stream.good();
+}
+bool Archive::close()
+{
+  string trailer(2 * RECORD_SIZE, '\0');
+  stream.write(trailer.data(), trailer.size());
+  stream.flush();
+  return stream.good();
+}
+void Archive::writeOctal(char* field, size_t size, uint64_t value)
+{
+  for (size_t index = size - 1; index > 0; --index)
+  {
+    field[index - 1] = '0' + (value & 7);
+    value >>= 3;
+  }
+  field[size - 1] = '\0';
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class Archive
+{
+public:
+  Archive(std::ostream& stream);
+
+public:
+  bool addFile(std::string name, const std::string& contents, bool executable);
+  bool close();
+
+private:
+  void writeOctal(char* field, size_t size, uint64_t value);
+
+  std::ostream& stream;
+};
@@ -1,4 +1,5 @@
 #include "Block.h"
+#include <cctype>
 using namespace std;
 
 Block::Block(string file, uint32_t line) : 
@@ -6,34 +7,82 @@ Block::Block(string file, uint32_t line) :
   sourceLine(line)
 {
 }
-Block::~Block()
-{
-}
 
-bool Block::checkEnd(string line)
+bool Block::checkEnd(const string& line) const
 {
   return (line == BLOCK_DELIMITER);
 }
-void Block::addLine(string line)
+void Block::addLine(string line, LineOrigin origin)
+{
+  lines.push_back(move(line));
+  origins.push_back(origin);
+}
+bool Block::parseReference(const string& line, string& whitespace,
+  string& name)
+{
+  size_t start = 0;
+  while ((start < line.size()) && isspace(static_cast<unsigned char>(
+    line[start])))
+  {
+    ++start;
+  }
+  if (line.compare(start, 2, "@{") != 0)
+  {
+    return false;
+  }
+  size_t end = line.size();
+  while ((end > start + 2) && isspace(static_cast<unsigned char>(
+    line[end - 1])))
+  {
+    --end;
+  }
+  if ((end < start + 4) || (line[end - 1] != '}'))
+  {
+    return false;
+  }
+  unsigned char first = line[start + 2];
+  if ((first != '[') && (first != ']') && (first != '_') && !isalnum(first) &&
+    !isspace(first))
+  {
+    return false;
+  }
+  for (size_t index = start + 3; index < end - 1; ++index)
+  {
+    if ((line[index] == '\r') || (line[index] == '\n'))
+    {
+      return false;
+    }
+  }
+  whitespace = line.substr(0, start);
+  name = line.substr(start + 2, end - start - 3);
+  return true;
+}
+void Block::setName(string newName)
 {
-  lines.push_back(line);
+  name = move(newName);
 }
-string Block::getSourceFile()
+
+const string& Block::getSourceFile() const
 {
   return sourceFile;
 }
 
-uint32_t Block::getSourceLine()
+uint32_t Block::getSourceLine() const
 {
   return sourceLine;
 }
 
-string Block::getName()
+const string& Block::getName() const
 {
   return name;
 }
 
-vector<string> Block::getLines()
+const vector<string>& Block::getLines() const
 {
   return lines;
 }
+
+const vector<LineOrigin>& Block::getOrigins() const
+{
+  return origins;
+}
@@ -5,25 +5,34 @@
 
 #define BLOCK_DELIMITER "```"
 
+struct LineOrigin
+{
+  uint32_t source;
+  uint32_t line;
+};
+
 class Block
 {
 public:
   Block(std::string sourceFile, uint32_t sourceLine);
-  virtual ~Block();
 
 public:
-  virtual bool parseHeader(std::string line) = 0;
-  bool checkEnd(std::string line);
-  void addLine(std::string line);
+  bool checkEnd(const std::string& line) const;
+  void addLine(std::string line, LineOrigin origin);
+  static bool parseReference(const std::string& line, std::string& whitespace,
+    std::string& name);
 
-  std::string getSourceFile();
-  uint32_t getSourceLine();
-  std::string getName();
-  std::vector<std::string> getLines();
+  void setName(std::string name);
+  const std::string& getSourceFile() const;
+  uint32_t getSourceLine() const;
+  const std::string& getName() const;
+  const std::vector<std::string>& getLines() const;
+  const std::vector<LineOrigin>& getOrigins() const;
 
 protected:
   std::string sourceFile;
   uint32_t sourceLine;
   std::string name;
   std::vector<std::string> lines;
+  std::vector<LineOrigin> origins;
 };
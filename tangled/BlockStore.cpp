@@ -0,0 +1,64 @@
+#include "BlockStore.h"
+using namespace std;
+
+bool BlockStore::addFileBlock(FileBlock block)
+{
+  if (!fileIndices.insert(make_pair(block.getName(),
+    static_cast<uint32_t>(fileBlocks.size()))).second)
+  {
+    return false;
+  }
+  fileBlocks.push_back(move(block));
+  return true;
+}
+
+bool BlockStore::addCodeBlock(CodeBlock block)
+{
+  if (!codeIndices.insert(make_pair(block.getName(),
+    static_cast<uint32_t>(codeBlocks.size()))).second)
+  {
+    return false;
+  }
+  codeBlocks.push_back(move(block));
+  return true;
+}
+bool BlockStore::findFileBlock(const string& name, uint32_t& index) const
+{
+  auto it = fileIndices.find(name);
+  if (it == fileIndices.end())
+  {
+    return false;
+  }
+  index = it->second;
+  return true;
+}
+
+bool BlockStore::findCodeBlock(const string& name, uint32_t& index) const
+{
+  auto it = codeIndices.find(name);
+  if (it == codeIndices.end())
+  {
+    return false;
+  }
+  index = it->second;
+  return true;
+}
+vector<FileBlock>& BlockStore::getFileBlocks()
+{
+  return fileBlocks;
+}
+
+vector<CodeBlock>& BlockStore::getCodeBlocks()
+{
+  return codeBlocks;
+}
+
+const vector<FileBlock>& BlockStore::getFileBlocks() const
+{
+  return fileBlocks;
+}
+
+const vector<CodeBlock>& BlockStore::getCodeBlocks() const
+{
+  return codeBlocks;
+}
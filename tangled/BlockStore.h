@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CodeBlock.h"
+#include "FileBlock.h"
+
+class BlockStore
+{
+public:
+  BlockStore() = default;
+  BlockStore(const BlockStore&) = delete;
+  BlockStore& operator=(const BlockStore&) = delete;
+  BlockStore(BlockStore&&) = default;
+  BlockStore& operator=(BlockStore&&) = default;
+
+public:
+  bool addFileBlock(FileBlock block);
+  bool addCodeBlock(CodeBlock block);
+  bool findFileBlock(const std::string& name, uint32_t& index) const;
+  bool findCodeBlock(const std::string& name, uint32_t& index) const;
+
+  std::vector<FileBlock>& getFileBlocks();
+  std::vector<CodeBlock>& getCodeBlocks();
+  const std::vector<FileBlock>& getFileBlocks() const;
+  const std::vector<CodeBlock>& getCodeBlocks() const;
+
+private:
+  std::vector<FileBlock> fileBlocks;
+  std::vector<CodeBlock> codeBlocks;
+  std::unordered_map<std::string, uint32_t> fileIndices;
+  std::unordered_map<std::string, uint32_t> codeIndices;
+};
@@ -0,0 +1,121 @@
+#include "Checker.h"
+#include <iostream>
+using namespace std;
+
+bool Checker::check(const BlockStore& blocks, uint32_t parserErrors)
+{
+  errorCount = parserErrors;
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  for (auto it = codeBlocks.begin(); it != codeBlocks.end(); ++it)
+  {
+    Node node;
+    node.block = &*it;
+    node.isFile = false;
+    nodes.push_back(node);
+  }
+  for (auto it = fileBlocks.begin(); it != fileBlocks.end(); ++it)
+  {
+    Node node;
+    node.block = &*it;
+    node.isFile = true;
+    nodes.push_back(node);
+  }
+  findReferences(blocks);
+  findCycles();
+  findUnused();
+  cout << "Check complete: " << errorCount << " error(s), " << warningCount <<
+    " warning(s)." << endl;
+  return (errorCount == 0);
+}
+void Checker::findReferences(const BlockStore& blocks)
+{
+  for (auto nodeIt = nodes.begin(); nodeIt != nodes.end(); ++nodeIt)
+  {
+    const vector<string>& lines = nodeIt->block->getLines();
+    for (auto lineIt = lines.begin(); lineIt != lines.end(); ++lineIt)
+    {
+      string whitespace, name;
+      if (!Block::parseReference(*lineIt, whitespace, name))
+      {
+        continue;
+      }
+      uint32_t child;
+      if (!blocks.findCodeBlock(name, child))
+      {
+        cout << "Error: Reference to undefined code block \"" << name <<
+          "\" in " << describe(*nodeIt) << "." << endl;
+        errorCount += 1;
+        continue;
+      }
+      nodeIt->children.push_back(child);
+      nodes[child].referenceCount += 1;
+    }
+  }
+}
+void Checker::findCycles()
+{
+  enum Color { White, Gray, Black };
+  vector<Color> colors(nodes.size(), White);
+  vector<pair<uint32_t, uint32_t>> stack;
+  for (uint32_t root = 0; root < nodes.size(); ++root)
+  {
+    if (colors[root] != White)
+    {
+      continue;
+    }
+    colors[root] = Gray;
+    stack.push_back(make_pair(root, 0));
+    while (!stack.empty())
+    {
+      uint32_t node = stack.back().first;
+      uint32_t childIndex = stack.back().second++;
+      if (childIndex == nodes[node].children.size())
+      {
+        colors[node] = Black;
+        stack.pop_back();
+        continue;
+      }
+      uint32_t child = nodes[node].children[childIndex];
+      if (colors[child] == White)
+      {
+        colors[child] = Gray;
+        stack.push_back(make_pair(child, 0));
+      }
+      else if (colors[child] == Gray)
+      {
+        size_t start = stack.size() - 1;
+        while (stack[start].first != child)
+        {
+          start -= 1;
+        }
+        string chain;
+        for (size_t index = start; index < stack.size(); ++index)
+        {
+          chain += "\"" + nodes[stack[index].first].block->getName() + "\" -> ";
+        }
+        chain += "\"" + nodes[child].block->getName() + "\"";
+        cout << "Error: Reference cycle " << chain << "." << endl;
+        errorCount += 1;
+      }
+    }
+  }
+}
+void Checker::findUnused()
+{
+  for (auto it = nodes.begin(); it != nodes.end(); ++it)
+  {
+    if (!it->isFile && (it->referenceCount == 0))
+    {
+      cout << "Warning: Unused " << describe(*it) << "." << endl;
+      warningCount += 1;
+    }
+  }
+}
+string Checker::describe(const Node& node)
+{
+  return string(node.isFile ? "file" : "code") + " block \"" +
+    node.block->getName() + "\" in line " +
+    to_string(node.block->getSourceLine()) + " of file \"" +
+    node.block->getSourceFile() + "\"";
+}
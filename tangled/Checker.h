@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BlockStore.h"
+
+class Checker
+{
+public:
+  bool check(const BlockStore& blocks, uint32_t parserErrors);
+
+private:
+  struct Node
+  {
+    const Block* block;
+    bool isFile;
+    std::vector<uint32_t> children;
+    uint32_t referenceCount = 0;
+  };
+
+  void findReferences(const BlockStore& blocks);
+  void findCycles();
+  void findUnused();
+  static std::string describe(const Node& node);
+
+  std::vector<Node> nodes;
+  uint32_t errorCount = 0;
+  uint32_t warningCount = 0;
+};
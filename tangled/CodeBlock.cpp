@@ -1,4 +1,6 @@
 #include "CodeBlock.h"
+#include <cstring>
+#include <iterator>
 using namespace std;
 #define CODE_BLOCK_PREFIX "@code "
 #define APPEND_POSTFIX " +="
@@ -8,9 +10,6 @@ CodeBlock::CodeBlock(string file, uint32_t line) :
   append(false)
 {
 }
-CodeBlock::~CodeBlock()
-{
-}
 
 bool CodeBlock::checkStart(string line1, string line2)
 {
@@ -28,7 +27,20 @@ bool CodeBlock::parseHeader(string line)
   }
   return true;
 }
-bool CodeBlock::getAppend()
+bool CodeBlock::getAppend() const
 {
   return append;
 }
+void CodeBlock::appendBlock(CodeBlock&& block)
+{
+  appendSources.push_back(make_pair(block.sourceFile, block.sourceLine));
+  lines.insert(lines.end(), make_move_iterator(block.lines.begin()),
+    make_move_iterator(block.lines.end()));
+  origins.insert(origins.end(), block.origins.begin(), block.origins.end());
+  block.lines.clear();
+  block.origins.clear();
+}
+const vector<pair<string, uint32_t>>& CodeBlock::getAppendSources() const
+{
+  return appendSources;
+}
@@ -6,13 +6,16 @@ class CodeBlock : public Block
 {
 public:
   CodeBlock(std::string sourceFile, uint32_t sourceLine);
-  virtual ~CodeBlock();
 
 public:
   static bool checkStart(std::string line1, std::string line2);
   bool parseHeader(std::string line);
-  bool getAppend();
+  bool getAppend() const;
+  void appendBlock(CodeBlock&& block);
+  const std::vector<std::pair<std::string, uint32_t>>& getAppendSources()
+    const;
 
 private:
   bool append;
+  std::vector<std::pair<std::string, uint32_t>> appendSources;
 };
@@ -0,0 +1,222 @@
+#include "Estimator.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+using namespace std;
+
+void Estimator::estimate(const BlockStore& blocks)
+{
+  findReferences(blocks);
+  sortNodes();
+  measureNodes();
+}
+void Estimator::findReferences(const BlockStore& blocks)
+{
+  nodes.clear();
+  complete = true;
+  codeCount = static_cast<uint32_t>(blocks.getCodeBlocks().size());
+  for (auto it = blocks.getCodeBlocks().begin();
+    it != blocks.getCodeBlocks().end(); ++it)
+  {
+    Node node;
+    node.block = &*it;
+    nodes.push_back(node);
+  }
+  for (auto it = blocks.getFileBlocks().begin();
+    it != blocks.getFileBlocks().end(); ++it)
+  {
+    Node node;
+    node.block = &*it;
+    nodes.push_back(node);
+  }
+  for (auto nodeIt = nodes.begin(); nodeIt != nodes.end(); ++nodeIt)
+  {
+    const vector<string>& lines = nodeIt->block->getLines();
+    for (auto lineIt = lines.begin(); lineIt != lines.end(); ++lineIt)
+    {
+      string whitespace, name;
+      uint32_t child;
+      if ((lineIt->find("@{") == string::npos) ||
+        !Block::parseReference(*lineIt, whitespace, name))
+      {
+        nodeIt->lines += 1;
+        nodeIt->bytes += lineIt->size() + 1;
+        continue;
+      }
+      if (blocks.findCodeBlock(name, child))
+      {
+        nodeIt->references.push_back(Reference{child, whitespace.size()});
+      }
+      else
+      {
+        complete = false;
+      }
+    }
+  }
+}
+void Estimator::sortNodes()
+{
+  enum Color { White, Gray, Black };
+  vector<Color> colors(nodes.size(), White);
+  vector<pair<uint32_t, uint32_t>> stack;
+  order.clear();
+  for (uint32_t root = 0; root < nodes.size(); ++root)
+  {
+    if (colors[root] != White)
+    {
+      continue;
+    }
+    colors[root] = Gray;
+    stack.push_back(make_pair(root, 0));
+    while (!stack.empty())
+    {
+      uint32_t node = stack.back().first;
+      uint32_t referenceIndex = stack.back().second++;
+      if (referenceIndex == nodes[node].references.size())
+      {
+        colors[node] = Black;
+        order.push_back(node);
+        stack.pop_back();
+        continue;
+      }
+      uint32_t child = nodes[node].references[referenceIndex].child;
+      if (colors[child] == White)
+      {
+        colors[child] = Gray;
+        stack.push_back(make_pair(child, 0));
+      }
+      else if (colors[child] == Gray)
+      {
+        complete = false;
+      }
+    }
+  }
+  reverse(order.begin(), order.end());
+}
+void Estimator::measureNodes()
+{
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    Node& node = nodes[*it];
+    for (auto refIt = node.references.begin(); refIt != node.references.end();
+      ++refIt)
+    {
+      const Node& child = nodes[refIt->child];
+      node.lines = add(node.lines, child.lines);
+      node.bytes = add(node.bytes, add(child.bytes,
+        multiply(refIt->indent, child.lines)));
+    }
+  }
+}
+
+bool Estimator::checkLimits(uint64_t maxOutputBytes, uint64_t maxTotalBytes)
+  const
+{
+  uint64_t totalBytes = 0;
+  uint32_t largest = codeCount;
+  for (uint32_t node = codeCount; node < nodes.size(); ++node)
+  {
+    if (nodes[node].bytes > maxOutputBytes)
+    {
+      cout << "Error: Output '" << nodes[node].block->getName() <<
+        "' would be " << nodes[node].bytes << " bytes, which is over the " <<
+        "limit of " << maxOutputBytes << "." << endl;
+      printChain(node);
+      return false;
+    }
+    totalBytes = add(totalBytes, nodes[node].bytes);
+    if (nodes[node].bytes > nodes[largest].bytes)
+    {
+      largest = node;
+    }
+  }
+  if (totalBytes > maxTotalBytes)
+  {
+    cout << "Error: The outputs would be " << totalBytes << " bytes in total, " <<
+      "which is over the limit of " << maxTotalBytes << "." << endl;
+    printChain(largest);
+    return false;
+  }
+  return true;
+}
+void Estimator::printChain(uint32_t node) const
+{
+  cout << "  " << nodes[node].block->getName() << " expands to " <<
+    nodes[node].bytes << " bytes" << endl;
+  vector<bool> visited(nodes.size(), false);
+  visited[node] = true;
+  while (true)
+  {
+    map<uint32_t, pair<uint64_t, uint64_t>> contributions;
+    uint32_t heaviest = static_cast<uint32_t>(nodes.size());
+    uint64_t heaviestBytes = 0;
+    const vector<Reference>& references = nodes[node].references;
+    for (auto it = references.begin(); it != references.end(); ++it)
+    {
+      const Node& child = nodes[it->child];
+      pair<uint64_t, uint64_t>& contribution = contributions[it->child];
+      contribution.first += 1;
+      contribution.second = add(contribution.second,
+        add(child.bytes, multiply(it->indent, child.lines)));
+      if ((heaviest == nodes.size()) || (contribution.second > heaviestBytes))
+      {
+        heaviest = it->child;
+        heaviestBytes = contribution.second;
+      }
+    }
+    if (heaviest == nodes.size())
+    {
+      break;
+    }
+    cout << "  -> " << contributions[heaviest].first <<
+      " reference(s) to '" << nodes[heaviest].block->getName() <<
+      "' add " << contributions[heaviest].second << " bytes" << endl;
+    if (visited[heaviest])
+    {
+      break;
+    }
+    visited[heaviest] = true;
+    node = heaviest;
+  }
+}
+
+uint32_t Estimator::getNodeCount() const
+{
+  return static_cast<uint32_t>(nodes.size());
+}
+
+uint64_t Estimator::getLines(uint32_t node) const
+{
+  return nodes[node].lines;
+}
+
+uint64_t Estimator::getBytes(uint32_t node) const
+{
+  return nodes[node].bytes;
+}
+
+const vector<Estimator::Reference>& Estimator::getReferences(uint32_t node)
+  const
+{
+  return nodes[node].references;
+}
+
+const vector<uint32_t>& Estimator::getOrder() const
+{
+  return order;
+}
+
+bool Estimator::isComplete() const
+{
+  return complete;
+}
+uint64_t Estimator::add(uint64_t left, uint64_t right)
+{
+  return (left > UINT64_MAX - right) ? UINT64_MAX : left + right;
+}
+
+uint64_t Estimator::multiply(uint64_t left, uint64_t right)
+{
+  return ((left != 0) && (right > UINT64_MAX / left)) ? UINT64_MAX :
+    left * right;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "BlockStore.h"
+
+class Estimator
+{
+public:
+  struct Reference
+  {
+    uint32_t child;
+    uint64_t indent;
+  };
+
+  void estimate(const BlockStore& blocks);
+  bool checkLimits(uint64_t maxOutputBytes, uint64_t maxTotalBytes) const;
+  uint32_t getNodeCount() const;
+  uint64_t getLines(uint32_t node) const;
+  uint64_t getBytes(uint32_t node) const;
+  const std::vector<Reference>& getReferences(uint32_t node) const;
+  const std::vector<uint32_t>& getOrder() const;
+  bool isComplete() const;
+  static uint64_t add(uint64_t left, uint64_t right);
+  static uint64_t multiply(uint64_t left, uint64_t right);
+
+private:
+  struct Node
+  {
+    const Block* block;
+    std::vector<Reference> references;
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+  };
+
+  void findReferences(const BlockStore& blocks);
+  void sortNodes();
+  void measureNodes();
+  void printChain(uint32_t node) const;
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> order;
+  uint32_t codeCount = 0;
+  bool complete = true;
+};
@@ -1,4 +1,5 @@
 #include "FileBlock.h"
+#include <cstring>
 using namespace std;
 #define FILE_BLOCK_PREFIX "@file "
 #define EXECUTE_POSTFIX " +x"
@@ -8,9 +9,6 @@ FileBlock::FileBlock(string file, uint32_t line) :
   executable(false)
 {
 }
-FileBlock::~FileBlock()
-{
-}
 
 bool FileBlock::checkStart(string line1, string line2)
 {
@@ -28,7 +26,7 @@ bool FileBlock::parseHeader(string line)
   }
   return true;
 }
-bool FileBlock::getExecutable()
+bool FileBlock::getExecutable() const
 {
   return executable;
 }
@@ -6,12 +6,11 @@ class FileBlock : public Block
 {
 public:
   FileBlock(std::string sourceFile, uint32_t sourceLine);
-  virtual ~FileBlock();
 
 public:
   static bool checkStart(std::string line1, std::string line2);
   bool parseHeader(std::string line);
-  bool getExecutable();
+  bool getExecutable() const;
 
 private:
   bool executable;
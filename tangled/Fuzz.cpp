@@ -0,0 +1,109 @@
+#include "Fuzz.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "Checker.h"
+#include "Estimator.h"
+#include "Parser.h"
+#include "Scheduler.h"
+#include "Tangler.h"
+using namespace std;
+#define FUZZ_ROOT "root.md"
+#define FUZZ_SOURCE_MARKER "%%% "
+#define FUZZ_JOBS 2
+#define FUZZ_MAX_BYTES (64ULL * 1024 * 1024)
+#define FUZZ_MAX_LINES (1024ULL * 1024)
+
+static void splitSources(const string& input,
+  unordered_map<string, string>& sources)
+{
+  string* contents = &sources[FUZZ_ROOT];
+  size_t markerLength = strlen(FUZZ_SOURCE_MARKER);
+  size_t start = 0;
+  while (start < input.size())
+  {
+    size_t end = input.find('\n', start);
+    end = (end == string::npos) ? input.size() : end + 1;
+    if (input.compare(start, markerLength, FUZZ_SOURCE_MARKER) == 0)
+    {
+      string path = input.substr(start + markerLength,
+        end - start - markerLength);
+      while (!path.empty() && ((path.back() == '\n') || (path.back() == '\r')))
+      {
+        path.pop_back();
+      }
+      contents = &sources[path];
+    }
+    else
+    {
+      contents->append(input, start, end - start);
+    }
+    start = end;
+  }
+}
+static bool isWithinLimits(const Estimator& estimator)
+{
+  uint64_t bytes = 0;
+  uint64_t lines = 0;
+  for (uint32_t node = 0; node < estimator.getNodeCount(); ++node)
+  {
+    bytes = Estimator::add(bytes, estimator.getBytes(node));
+    lines = Estimator::add(lines, estimator.getLines(node));
+  }
+  return (bytes <= FUZZ_MAX_BYTES) && (lines <= FUZZ_MAX_LINES);
+}
+static string testSources(const unordered_map<string, string>& sources,
+  Scheduler& scheduler)
+{
+  Parser parser(scheduler);
+  parser.setMemorySources(&sources);
+  parser.setKeepGoing(true);
+  parser.parse(FUZZ_ROOT);
+  const BlockStore blocks = parser.releaseBlocks();
+  Checker checker;
+  bool checked = checker.check(blocks, parser.getErrorCount());
+  stringstream summary;
+  summary << parser.getSources().size() << " source(s), " <<
+    (blocks.getFileBlocks().size() + blocks.getCodeBlocks().size()) <<
+    " block(s), check " << (checked ? "passed" : "failed") << ", ";
+  if (parser.getErrorCount() != 0)
+  {
+    return summary.str() + "not tangled after parser errors";
+  }
+  Estimator estimator;
+  estimator.estimate(blocks);
+  if (!isWithinLimits(estimator))
+  {
+    return summary.str() + "not tangled because it's over the limits";
+  }
+  Tangler tangler;
+  tangler.setScheduler(&scheduler);
+  tangler.setEstimator(&estimator);
+  tangler.setProvenance(parser.getSources(), parser.getImportedPaths(), false,
+    true);
+  ostringstream archive;
+  if (!tangler.tangleToArchive(blocks, archive))
+  {
+    return summary.str() + "tangling failed";
+  }
+  summary << "tangled to " << archive.str().size() << " bytes";
+  return summary.str();
+}
+string testInput(const uint8_t* data, size_t size)
+{
+  static Scheduler scheduler(FUZZ_JOBS);
+  unordered_map<string, string> sources;
+  splitSources(string(reinterpret_cast<const char*>(data), size), sources);
+  streambuf* messages = cout.rdbuf(nullptr);
+  string summary = testSources(sources, scheduler);
+  cout.rdbuf(messages);
+  cout.clear();
+  return summary;
+}
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  testInput(data, size);
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include "Graph.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+bool Graph::write(const vector<Source>& sources, string path)
+{
+  ofstream stream(path);
+  if (!stream.good())
+  {
+    cout << "Error: Failed to open graph file '" << path << "'." << endl;
+    return false;
+  }
+  string extension = ".json";
+  if ((path.size() >= extension.size()) &&
+    (path.compare(path.size() - extension.size(), extension.size(),
+    extension) == 0))
+  {
+    writeJson(sources, stream);
+  }
+  else
+  {
+    writeDot(sources, stream);
+  }
+  return stream.good();
+}
+void Graph::writeDot(const vector<Source>& sources, ostream& stream)
+{
+  stream << "digraph web {" << endl;
+  stream << "  node [shape=box];" << endl;
+  for (auto it = sources.begin(); it != sources.end(); ++it)
+  {
+    string label = quote(it->path, false);
+    label.insert(label.size() - 1, "\\n" + to_string(it->lineCount) +
+      " lines, " + to_string(it->blockCount) + " blocks\\n" +
+      to_string(it->parseMicroseconds) + " us");
+    stream << "  " << quote(it->path, false) << " [label=" << label <<
+      (it->found ? "" : ", style=dashed") << "];" << endl;
+  }
+  for (auto it = sources.begin(); it != sources.end(); ++it)
+  {
+    for (auto linkIt = it->links.begin(); linkIt != it->links.end(); ++linkIt)
+    {
+      stream << "  " << quote(it->path, false) << " -> " <<
+        quote(*linkIt, false) << ";" << endl;
+    }
+  }
+  stream << "}" << endl;
+}
+void Graph::writeJson(const vector<Source>& sources, ostream& stream)
+{
+  stream << "[" << endl;
+  for (auto it = sources.begin(); it != sources.end(); ++it)
+  {
+    stream << "  {\"path\": " << quote(it->path, true) << ", \"found\": " <<
+      (it->found ? "true" : "false") << ", \"lines\": " << it->lineCount <<
+      ", \"blocks\": " << it->blockCount << ", \"parseMicroseconds\": " <<
+      it->parseMicroseconds << ", \"links\": [";
+    for (auto linkIt = it->links.begin(); linkIt != it->links.end(); ++linkIt)
+    {
+      stream << ((linkIt == it->links.begin()) ? "" : ", ") <<
+        quote(*linkIt, true);
+    }
+    stream << "]}" << (((it + 1) == sources.end()) ? "" : ",") << endl;
+  }
+  stream << "]" << endl;
+}
+string Graph::quote(string text, bool json)
+{
+  string quoted = "\"";
+  for (auto it = text.begin(); it != text.end(); ++it)
+  {
+    unsigned char character = static_cast<unsigned char>(*it);
+    if (json && (character < 0x20))
+    {
+      char escape[7];
+      snprintf(escape, sizeof(escape), "\\u%04x", character);
+      quoted += escape;
+      continue;
+    }
+    if ((*it == '"') || (*it == '\\'))
+    {
+      quoted += '\\';
+    }
+    quoted += *it;
+  }
+  return quoted + "\"";
+}
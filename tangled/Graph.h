@@ -0,0 +1,19 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+class Graph
+{
+public:
+  static bool write(const std::vector<Source>& sources, std::string path);
+
+private:
+  static void writeDot(const std::vector<Source>& sources,
+    std::ostream& stream);
+  static void writeJson(const std::vector<Source>& sources,
+    std::ostream& stream);
+  static std::string quote(std::string text, bool json);
+};
@@ -0,0 +1,269 @@
+#include "Library.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include "Tangler.h"
+#if defined(__linux__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+using namespace std;
+#define LIBRARY_MAGIC "LITLIB01"
+#define LIBRARY_HEADER_NUMBERS 4
+#define LIBRARY_SOURCE_NUMBERS 2
+#define LIBRARY_BLOCK_NUMBERS 7
+#define LIBRARY_LINE_NUMBERS 4
+#define LIBRARY_EXPANDED 1
+#define NO_SOURCE 0xFFFFFFFF
+
+Library::Library() :
+  data(nullptr),
+  size(0),
+  blockCount(0),
+  lineCount(0),
+  blockTable(0),
+  lineTable(0),
+  pool(0),
+  poolSize(0)
+{
+}
+Library::~Library()
+{
+#if defined(__linux__) || defined(__APPLE__)
+  if ((data != nullptr) && buffer.empty())
+  {
+    munmap(const_cast<char*>(data), size);
+  }
+#endif
+}
+
+bool Library::write(const string& path, const BlockStore& blocks,
+  const vector<const TangledBlock*>& expanded,
+  const vector<string>& sourcePaths)
+{
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  string sourceTable, blockTable, lineTable, pool;
+  uint32_t lineCount = 0;
+  unordered_map<string, uint32_t> sourceIndices;
+  for (auto it = sourcePaths.begin(); it != sourcePaths.end(); ++it)
+  {
+    sourceIndices.insert(make_pair(*it,
+      static_cast<uint32_t>(sourceIndices.size())));
+    writeNumber(sourceTable, static_cast<uint32_t>(pool.size()));
+    writeNumber(sourceTable, static_cast<uint32_t>(it->size()));
+    pool += *it;
+  }
+  vector<uint32_t> order;
+  for (uint32_t index = 0; index < codeBlocks.size(); ++index)
+  {
+    order.push_back(index);
+  }
+  sort(order.begin(), order.end(), [&](uint32_t left, uint32_t right)
+  {
+    return codeBlocks[left].getName() < codeBlocks[right].getName();
+  });
+  for (auto it = order.begin(); it != order.end(); ++it)
+  {
+    const CodeBlock& block = codeBlocks[*it];
+    const vector<string>& lines = (expanded[*it] != nullptr) ?
+      expanded[*it]->lines : block.getLines();
+    const vector<LineOrigin>& origins = (expanded[*it] != nullptr) ?
+      expanded[*it]->origins : block.getOrigins();
+    auto sourceIt = sourceIndices.find(block.getSourceFile());
+    uint32_t source = (sourceIt != sourceIndices.end()) ? sourceIt->second :
+      NO_SOURCE;
+    writeNumber(blockTable, static_cast<uint32_t>(pool.size()));
+    writeNumber(blockTable, static_cast<uint32_t>(block.getName().size()));
+    pool += block.getName();
+    writeNumber(blockTable, lineCount);
+    writeNumber(blockTable, static_cast<uint32_t>(lines.size()));
+    writeNumber(blockTable, (expanded[*it] != nullptr) ? LIBRARY_EXPANDED : 0);
+    writeNumber(blockTable, source);
+    writeNumber(blockTable, block.getSourceLine());
+    for (size_t index = 0; index < lines.size(); ++index)
+    {
+      writeNumber(lineTable, static_cast<uint32_t>(pool.size()));
+      writeNumber(lineTable, static_cast<uint32_t>(lines[index].size()));
+      writeNumber(lineTable, origins[index].source);
+      writeNumber(lineTable, origins[index].line);
+      pool += lines[index];
+    }
+    lineCount += static_cast<uint32_t>(lines.size());
+  }
+  string header = LIBRARY_MAGIC;
+  writeNumber(header, static_cast<uint32_t>(sourcePaths.size()));
+  writeNumber(header, static_cast<uint32_t>(codeBlocks.size()));
+  writeNumber(header, lineCount);
+  writeNumber(header, static_cast<uint32_t>(pool.size()));
+  ofstream stream(path, ios::binary);
+  stream << header << sourceTable << blockTable << lineTable << pool;
+  stream.close();
+  if (!stream.good())
+  {
+    cout << "Error: Failed to write library '" << path << "'." << endl;
+    return false;
+  }
+  return true;
+}
+bool Library::open(const string& libraryPath)
+{
+  path = libraryPath;
+  #if defined(__linux__) || defined(__APPLE__)
+  int fd = ::open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if ((fd < 0) || (fstat(fd, &st) != 0))
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    cout << "Error: Failed to open library '" << path << "'." << endl;
+    return false;
+  }
+  size = st.st_size;
+  void* mapped = (size > 0) ?
+    mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    cout << "Error: Failed to map library '" << path << "'." << endl;
+    return false;
+  }
+  data = static_cast<const char*>(mapped);
+  #else
+  ifstream stream(path, ios::binary);
+  if (!stream.good())
+  {
+    cout << "Error: Failed to open library '" << path << "'." << endl;
+    return false;
+  }
+  stringstream contents;
+  contents << stream.rdbuf();
+  buffer = contents.str();
+  data = buffer.data();
+  size = buffer.size();
+  #endif
+  size_t offset = strlen(LIBRARY_MAGIC);
+  uint32_t sourceCount = 0;
+  bool valid = (size >= offset + LIBRARY_HEADER_NUMBERS * 4) &&
+    (memcmp(data, LIBRARY_MAGIC, offset) == 0);
+  if (valid)
+  {
+    sourceCount = readNumber(offset);
+    blockCount = readNumber(offset + 4);
+    lineCount = readNumber(offset + 8);
+    poolSize = readNumber(offset + 12);
+    offset += LIBRARY_HEADER_NUMBERS * 4;
+    blockTable = offset + uint64_t(sourceCount) * LIBRARY_SOURCE_NUMBERS * 4;
+    lineTable = blockTable + uint64_t(blockCount) * LIBRARY_BLOCK_NUMBERS * 4;
+    pool = lineTable + uint64_t(lineCount) * LIBRARY_LINE_NUMBERS * 4;
+    valid = (pool + poolSize == size);
+  }
+  for (uint32_t index = 0; valid && (index < sourceCount); ++index)
+  {
+    string sourcePath;
+    size_t entry = offset + index * LIBRARY_SOURCE_NUMBERS * 4;
+    valid = readString(readNumber(entry), readNumber(entry + 4), sourcePath);
+    sourcePaths.push_back(sourcePath);
+  }
+  if (!valid)
+  {
+    cout << "Error: Failed to read library '" << path << "'." << endl;
+  }
+  return valid;
+}
+const vector<string>& Library::getSourcePaths() const
+{
+  return sourcePaths;
+}
+bool Library::importBlock(const string& name, uint32_t sourceBase,
+  CodeBlock& block, bool& expanded) const
+{
+  uint32_t low = 0;
+  uint32_t high = blockCount;
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2;
+    size_t entry = blockTable + size_t(middle) * LIBRARY_BLOCK_NUMBERS * 4;
+    string entryName;
+    if (!readString(readNumber(entry), readNumber(entry + 4), entryName))
+    {
+      cout << "Error: Failed to read library '" << path << "'." << endl;
+      return false;
+    }
+    int comparison = entryName.compare(name);
+    if (comparison == 0)
+    {
+      uint32_t firstLine = readNumber(entry + 8);
+      uint32_t count = readNumber(entry + 12);
+      uint32_t source = readNumber(entry + 20);
+      expanded = (readNumber(entry + 16) & LIBRARY_EXPANDED) != 0;
+      block = CodeBlock((source < sourcePaths.size()) ? sourcePaths[source] : path,
+        readNumber(entry + 24));
+      block.setName(name);
+      if (uint64_t(firstLine) + count > lineCount)
+      {
+        cout << "Error: Failed to read library '" << path << "'." << endl;
+        return false;
+      }
+      for (uint32_t index = firstLine; index < firstLine + count; ++index)
+      {
+        size_t lineEntry = lineTable + size_t(index) * LIBRARY_LINE_NUMBERS * 4;
+        string line;
+        if (!readString(readNumber(lineEntry), readNumber(lineEntry + 4), line))
+        {
+          cout << "Error: Failed to read library '" << path << "'." << endl;
+          return false;
+        }
+        uint32_t lineSource = readNumber(lineEntry + 8);
+        block.addLine(move(line), LineOrigin{(lineSource == NO_SOURCE) ?
+          NO_SOURCE : sourceBase + lineSource, readNumber(lineEntry + 12)});
+      }
+      return true;
+    }
+    if (comparison < 0)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return false;
+}
+
+void Library::writeNumber(string& data, uint32_t value)
+{
+  for (int index = 0; index < 4; ++index)
+  {
+    data += static_cast<char>((value >> (8 * index)) & 0xFF);
+  }
+}
+
+uint32_t Library::readNumber(size_t offset) const
+{
+  uint32_t value = 0;
+  for (int index = 0; index < 4; ++index)
+  {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(
+      data[offset + index])) << (8 * index);
+  }
+  return value;
+}
+
+bool Library::readString(uint32_t offset, uint32_t length,
+  string& value) const
+{
+  if (uint64_t(offset) + length > poolSize)
+  {
+    return false;
+  }
+  value.assign(data + pool + offset, length);
+  return true;
+}
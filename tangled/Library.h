@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockStore.h"
+
+struct TangledBlock;
+
+class Library
+{
+public:
+  Library();
+  virtual ~Library();
+  Library(const Library&) = delete;
+  Library& operator=(const Library&) = delete;
+
+public:
+  static bool write(const std::string& path, const BlockStore& blocks,
+    const std::vector<const TangledBlock*>& expanded,
+    const std::vector<std::string>& sourcePaths);
+  bool open(const std::string& path);
+  const std::vector<std::string>& getSourcePaths() const;
+  bool importBlock(const std::string& name, uint32_t sourceBase,
+    CodeBlock& block, bool& expanded) const;
+
+private:
+  static void writeNumber(std::string& data, uint32_t value);
+  uint32_t readNumber(size_t offset) const;
+  bool readString(uint32_t offset, uint32_t length, std::string& value) const;
+
+  std::string path;
+  const char* data;
+  size_t size;
+  std::string buffer;
+  uint32_t blockCount;
+  uint32_t lineCount;
+  size_t blockTable;
+  size_t lineTable;
+  size_t pool;
+  uint32_t poolSize;
+  std::vector<std::string> sourcePaths;
+};
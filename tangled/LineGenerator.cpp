@@ -0,0 +1,65 @@
+#include "LineGenerator.h"
+using namespace std;
+#define NO_CODE_INDEX 0xFFFFFFFF
+
+LineGenerator::LineGenerator(const BlockStore& store, const Block* block) :
+  blocks(store),
+  isExpanding(store.getCodeBlocks().size(), false)
+{
+  stack.push_back(Frame{block, NO_CODE_INDEX, 0, ""});
+}
+
+bool LineGenerator::next(string& line, LineOrigin& origin)
+{
+  while (!stack.empty())
+  {
+    Frame& frame = stack.back();
+    const vector<string>& lines = frame.block->getLines();
+    if (frame.lineIndex == lines.size())
+    {
+      if (frame.codeIndex != NO_CODE_INDEX)
+      {
+        isExpanding[frame.codeIndex] = false;
+      }
+      stack.pop_back();
+      continue;
+    }
+    size_t index = frame.lineIndex++;
+    string whitespace, name;
+    if ((lines[index].find("@{") == string::npos) ||
+      !Block::parseReference(lines[index], whitespace, name))
+    {
+      line = frame.indent + lines[index];
+      origin = frame.block->getOrigins()[index];
+      return true;
+    }
+    if (!pushChild(frame.indent + whitespace, name))
+    {
+      stack.clear();
+      return false;
+    }
+  }
+  return false;
+}
+bool LineGenerator::pushChild(const string& indent, const string& name)
+{
+  uint32_t codeIndex;
+  if (!blocks.findCodeBlock(name, codeIndex))
+  {
+    error = "Unable to find block '" + name + "'.";
+    return false;
+  }
+  if (isExpanding[codeIndex])
+  {
+    error = "Reference cycle through block '" + name + "'.";
+    return false;
+  }
+  isExpanding[codeIndex] = true;
+  stack.push_back(Frame{&blocks.getCodeBlocks()[codeIndex], codeIndex, 0,
+    indent});
+  return true;
+}
+const string& LineGenerator::getError() const
+{
+  return error;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockStore.h"
+
+class LineGenerator
+{
+public:
+  LineGenerator(const BlockStore& blocks, const Block* block);
+
+public:
+  bool next(std::string& line, LineOrigin& origin);
+  const std::string& getError() const;
+
+private:
+  struct Frame
+  {
+    const Block* block;
+    uint32_t codeIndex;
+    size_t lineIndex;
+    std::string indent;
+  };
+
+  bool pushChild(const std::string& whitespace, const std::string& name);
+
+  const BlockStore& blocks;
+  std::vector<Frame> stack;
+  std::vector<bool> isExpanding;
+  std::string error;
+};
@@ -1,9 +1,24 @@
 #include "Main.h"
 #define OPTPARSE_IMPLEMENTATION
+#include "Checker.h"
+#include "Estimator.h"
+#include "Graph.h"
+#include "Library.h"
+#include "Manifest.h"
 #include "Optparse.h"
+#include "OutputCache.h"
 #include "Parser.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "SourceMap.h"
 #include "Tangler.h"
+#include "Weaver.h"
+#include <cstdlib>
 #include <iostream>
+#ifdef _WIN32
+  #include <fcntl.h>
+  #include <io.h>
+#endif
 using namespace std;
 #define LITERATE_VERSION "0.2"
 
@@ -14,9 +29,51 @@ int32_t Main::run(int argc, char** argv)
     {"help", 'h', OPTPARSE_NONE},
     {"version", 'v', OPTPARSE_NONE},
     {"out", 'o', OPTPARSE_REQUIRED},
+    {"stdout", 's', OPTPARSE_REQUIRED},
+    {"tar", 't', OPTPARSE_NONE},
+    {"graph", 'g', OPTPARSE_REQUIRED},
+    {"weave", 'w', OPTPARSE_REQUIRED},
+    {"check", 'c', OPTPARSE_NONE},
+    {"source-map", 'm', OPTPARSE_NONE},
+    {"line-directives", 'l', OPTPARSE_NONE},
+    {"pipeline", 'p', OPTPARSE_NONE},
+    {"profile-blocks", 'P', OPTPARSE_NONE},
+    {"verify", 'V', OPTPARSE_NONE},
+    {"compile", 'C', OPTPARSE_REQUIRED},
+    {"import", 'i', OPTPARSE_REQUIRED},
+    {"preview", 'r', OPTPARSE_REQUIRED},
+    {"lines", 'n', OPTPARSE_REQUIRED},
+    {"locate", 'L', OPTPARSE_REQUIRED},
+    {"max-output-bytes", 'b', OPTPARSE_REQUIRED},
+    {"max-total-bytes", 'B', OPTPARSE_REQUIRED},
+    {"cache", 'k', OPTPARSE_REQUIRED},
+    {"jobs", 'j', OPTPARSE_REQUIRED},
+    {"utilization", 'u', OPTPARSE_NONE},
+    {"stdin-name", 'N', OPTPARSE_REQUIRED},
     {0}
   };
   string outputDirectory(".");
+  string streamFile;
+  bool archive = false;
+  string graphFile;
+  string weaveDirectory;
+  bool check = false;
+  bool sourceMaps = false;
+  bool lineDirectives = false;
+  bool pipeline = false;
+  bool profile = false;
+  bool verify = false;
+  string libraryFile;
+  vector<string> imports;
+  string previewBlock;
+  uint32_t previewLines = 20;
+  string locateTarget;
+  uint64_t maxOutputBytes = UINT64_MAX;
+  uint64_t maxTotalBytes = UINT64_MAX;
+  string cacheDirectory;
+  uint32_t jobs = 0;
+  bool utilization = false;
+  string stdinName;
   int option;
   struct optparse options;
   optparse_init(&options, argv);
@@ -27,10 +84,50 @@ int32_t Main::run(int argc, char** argv)
     case 'h':
       cout << "Usage:" << endl;
       cout << "  lit [options] <literate file>" << endl << endl;
+      cout << "Use - as the literate file to read it from stdin." << endl << endl;
       cout << "Options:" << endl;
-      cout << "  --help/-h      Show the help text." << endl;
-      cout << "  --version/-v   Show the version number." << endl;
-      cout << "  --out/-o DIR   Put the generated files in DIR." << endl;
+      cout << "  --help/-h         Show the help text." << endl;
+      cout << "  --version/-v      Show the version number." << endl;
+      cout << "  --out/-o DIR      Put the generated files in DIR." << endl;
+      cout << "  --stdout/-s FILE  Write the file block FILE to stdout." << endl;
+      cout << "  --tar/-t          Write all file blocks to stdout as a tar archive." <<
+        endl;
+      cout << "  --graph/-g FILE   Write the include graph to FILE as DOT or JSON." <<
+        endl;
+      cout << "  --weave/-w DIR    Also write HTML documentation to DIR." << endl;
+      cout << "  --check/-c        Report all problems without writing output." << endl;
+      cout << "  --source-map/-m   Write a source map next to each output file." << endl;
+      cout << "  --line-directives/-l" << endl;
+      cout << "                    Insert #line directives into C and C++ output." <<
+        endl;
+      cout << "  --pipeline/-p     Write outputs while the web is still being parsed." <<
+        endl;
+      cout << "  --profile-blocks/-P" << endl;
+      cout << "                    Print the output size and tangle time of each block." <<
+        endl;
+      cout << "  --verify/-V       Check the outputs are current without writing them." <<
+        endl;
+      cout << "  --compile/-C FILE Compile the code blocks into the library FILE." <<
+        endl;
+      cout << "  --import/-i FILE  Import missing code blocks from the library FILE." <<
+        endl;
+      cout << "  --preview/-r NAME Print the first lines of the block NAME." << endl;
+      cout << "  --lines/-n N      Print N lines with --preview (default 20)." << endl;
+      cout << "  --locate/-L OUT:LINE" << endl;
+      cout << "                    Print the literate source of line LINE of OUT." <<
+        endl;
+      cout << "  --max-output-bytes/-b N" << endl;
+      cout << "                    Fail if any output would be over N bytes." << endl;
+      cout << "  --max-total-bytes/-B N" << endl;
+      cout << "                    Fail if all outputs would be over N bytes in total." <<
+        endl;
+      cout << "  --cache/-k DIR    Share tangled outputs through the cache DIR." << endl;
+      cout << "  --jobs/-j N       Use N worker threads, or 'auto' (the default)." <<
+        endl;
+      cout << "  --utilization/-u  Print how busy each worker thread was." << endl;
+      cout << "  --stdin-name/-N FILE" << endl;
+      cout << "                    Name the literate file read from stdin FILE." <<
+        endl;
       return 0;
   
     case 'v':
@@ -41,16 +138,192 @@ int32_t Main::run(int argc, char** argv)
       outputDirectory = options.optarg;
       break;
   
+    case 's':
+      streamFile = options.optarg;
+      break;
+  
+    case 't':
+      archive = true;
+      break;
+  
+    case 'g':
+      graphFile = options.optarg;
+      break;
+  
+    case 'w':
+      weaveDirectory = options.optarg;
+      break;
+  
+    case 'c':
+      check = true;
+      break;
+  
+    case 'm':
+      sourceMaps = true;
+      break;
+  
+    case 'l':
+      lineDirectives = true;
+      break;
+  
+    case 'p':
+      pipeline = true;
+      break;
+  
+    case 'P':
+      profile = true;
+      break;
+  
+    case 'V':
+      verify = true;
+      break;
+  
+    case 'C':
+      libraryFile = options.optarg;
+      break;
+  
+    case 'i':
+      imports.push_back(options.optarg);
+      break;
+  
+    case 'r':
+      previewBlock = options.optarg;
+      break;
+  
+    case 'n':
+      previewLines = static_cast<uint32_t>(strtoul(options.optarg, nullptr, 10));
+      break;
+  
+    case 'L':
+      locateTarget = options.optarg;
+      break;
+  
+    case 'b':
+      maxOutputBytes = strtoull(options.optarg, nullptr, 10);
+      break;
+  
+    case 'B':
+      maxTotalBytes = strtoull(options.optarg, nullptr, 10);
+      break;
+  
+    case 'k':
+      cacheDirectory = options.optarg;
+      break;
+  
+    case 'j':
+      if (string(options.optarg) != "auto")
+      {
+        jobs = static_cast<uint32_t>(strtoul(options.optarg, nullptr, 10));
+        if (jobs == 0)
+        {
+          cout << "Error: Expected a number of jobs or 'auto' but found '" <<
+            options.optarg << "'." << endl;
+          return -1;
+        }
+      }
+      break;
+  
+    case 'u':
+      utilization = true;
+      break;
+  
+    case 'N':
+      stdinName = options.optarg;
+      break;
+  
     default:
       cout << "Error: Unknown command line parameter." << endl << endl;
       cout << "Usage:" << endl;
       cout << "  lit [options] <literate file>" << endl << endl;
+      cout << "Use - as the literate file to read it from stdin." << endl << endl;
       cout << "Options:" << endl;
-      cout << "  --help/-h      Show the help text." << endl;
-      cout << "  --version/-v   Show the version number." << endl;
-      cout << "  --out/-o DIR   Put the generated files in DIR." << endl;
+      cout << "  --help/-h         Show the help text." << endl;
+      cout << "  --version/-v      Show the version number." << endl;
+      cout << "  --out/-o DIR      Put the generated files in DIR." << endl;
+      cout << "  --stdout/-s FILE  Write the file block FILE to stdout." << endl;
+      cout << "  --tar/-t          Write all file blocks to stdout as a tar archive." <<
+        endl;
+      cout << "  --graph/-g FILE   Write the include graph to FILE as DOT or JSON." <<
+        endl;
+      cout << "  --weave/-w DIR    Also write HTML documentation to DIR." << endl;
+      cout << "  --check/-c        Report all problems without writing output." << endl;
+      cout << "  --source-map/-m   Write a source map next to each output file." << endl;
+      cout << "  --line-directives/-l" << endl;
+      cout << "                    Insert #line directives into C and C++ output." <<
+        endl;
+      cout << "  --pipeline/-p     Write outputs while the web is still being parsed." <<
+        endl;
+      cout << "  --profile-blocks/-P" << endl;
+      cout << "                    Print the output size and tangle time of each block." <<
+        endl;
+      cout << "  --verify/-V       Check the outputs are current without writing them." <<
+        endl;
+      cout << "  --compile/-C FILE Compile the code blocks into the library FILE." <<
+        endl;
+      cout << "  --import/-i FILE  Import missing code blocks from the library FILE." <<
+        endl;
+      cout << "  --preview/-r NAME Print the first lines of the block NAME." << endl;
+      cout << "  --lines/-n N      Print N lines with --preview (default 20)." << endl;
+      cout << "  --locate/-L OUT:LINE" << endl;
+      cout << "                    Print the literate source of line LINE of OUT." <<
+        endl;
+      cout << "  --max-output-bytes/-b N" << endl;
+      cout << "                    Fail if any output would be over N bytes." << endl;
+      cout << "  --max-total-bytes/-B N" << endl;
+      cout << "                    Fail if all outputs would be over N bytes in total." <<
+        endl;
+      cout << "  --cache/-k DIR    Share tangled outputs through the cache DIR." << endl;
+      cout << "  --jobs/-j N       Use N worker threads, or 'auto' (the default)." <<
+        endl;
+      cout << "  --utilization/-u  Print how busy each worker thread was." << endl;
+      cout << "  --stdin-name/-N FILE" << endl;
+      cout << "                    Name the literate file read from stdin FILE." <<
+        endl;
+      return -1;
+    }
+  }
+  if (!streamFile.empty() && archive)
+  {
+    cout << "Error: The --stdout and --tar options cannot be combined." << endl;
+    return -1;
+  }
+  if (verify && (!streamFile.empty() || archive))
+  {
+    cout << "Error: The --verify option cannot be combined with --stdout or --tar." <<
+      endl;
+    return -1;
+  }
+  if (!locateTarget.empty())
+  {
+    size_t colon = locateTarget.rfind(':');
+    uint32_t outputLine = 0;
+    if (colon != string::npos)
+    {
+      outputLine = static_cast<uint32_t>(strtoul(locateTarget.c_str() + colon + 1,
+        nullptr, 10));
+    }
+    if (outputLine == 0)
+    {
+      cout << "Error: Expected OUT:LINE but found '" << locateTarget << "'." <<
+        endl;
+      return -1;
+    }
+    string outputFile = locateTarget.substr(0, colon);
+    SourceMap sourceMap;
+    string sourceFile;
+    uint32_t sourceLine;
+    if (!sourceMap.read(outputFile + SOURCE_MAP_EXTENSION))
+    {
+      return -1;
+    }
+    if (!sourceMap.locate(outputLine, sourceFile, sourceLine))
+    {
+      cout << "Error: Line " << outputLine << " of '" << outputFile <<
+        "' did not come from a literate source." << endl;
       return -1;
     }
+    cout << sourceFile << ":" << sourceLine << endl;
+    return 0;
   }
   char* arg = optparse_arg(&options);
   if (arg == nullptr)
@@ -58,24 +331,229 @@ int32_t Main::run(int argc, char** argv)
     cout << "Error: Missing required literate source file in command line parameters." << endl << endl;
     cout << "Usage:" << endl;
     cout << "  lit [options] <literate file>" << endl << endl;
+    cout << "Use - as the literate file to read it from stdin." << endl << endl;
     cout << "Options:" << endl;
-    cout << "  --help/-h      Show the help text." << endl;
-    cout << "  --version/-v   Show the version number." << endl;
-    cout << "  --out/-o DIR   Put the generated files in DIR." << endl;
+    cout << "  --help/-h         Show the help text." << endl;
+    cout << "  --version/-v      Show the version number." << endl;
+    cout << "  --out/-o DIR      Put the generated files in DIR." << endl;
+    cout << "  --stdout/-s FILE  Write the file block FILE to stdout." << endl;
+    cout << "  --tar/-t          Write all file blocks to stdout as a tar archive." <<
+      endl;
+    cout << "  --graph/-g FILE   Write the include graph to FILE as DOT or JSON." <<
+      endl;
+    cout << "  --weave/-w DIR    Also write HTML documentation to DIR." << endl;
+    cout << "  --check/-c        Report all problems without writing output." << endl;
+    cout << "  --source-map/-m   Write a source map next to each output file." << endl;
+    cout << "  --line-directives/-l" << endl;
+    cout << "                    Insert #line directives into C and C++ output." <<
+      endl;
+    cout << "  --pipeline/-p     Write outputs while the web is still being parsed." <<
+      endl;
+    cout << "  --profile-blocks/-P" << endl;
+    cout << "                    Print the output size and tangle time of each block." <<
+      endl;
+    cout << "  --verify/-V       Check the outputs are current without writing them." <<
+      endl;
+    cout << "  --compile/-C FILE Compile the code blocks into the library FILE." <<
+      endl;
+    cout << "  --import/-i FILE  Import missing code blocks from the library FILE." <<
+      endl;
+    cout << "  --preview/-r NAME Print the first lines of the block NAME." << endl;
+    cout << "  --lines/-n N      Print N lines with --preview (default 20)." << endl;
+    cout << "  --locate/-L OUT:LINE" << endl;
+    cout << "                    Print the literate source of line LINE of OUT." <<
+      endl;
+    cout << "  --max-output-bytes/-b N" << endl;
+    cout << "                    Fail if any output would be over N bytes." << endl;
+    cout << "  --max-total-bytes/-B N" << endl;
+    cout << "                    Fail if all outputs would be over N bytes in total." <<
+      endl;
+    cout << "  --cache/-k DIR    Share tangled outputs through the cache DIR." << endl;
+    cout << "  --jobs/-j N       Use N worker threads, or 'auto' (the default)." <<
+      endl;
+    cout << "  --utilization/-u  Print how busy each worker thread was." << endl;
+    cout << "  --stdin-name/-N FILE" << endl;
+    cout << "                    Name the literate file read from stdin FILE." <<
+      endl;
     return -1;
   }
   string literateFile = arg;
-  Parser parser;
-  if (!parser.parse(literateFile))
+  ostream outputStream(cout.rdbuf());
+  if (!streamFile.empty() || archive)
   {
-    return -1;
+  #ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+  #endif
+    cout.rdbuf(cerr.rdbuf());
+  }
+  string manifestKey = string(LITERATE_VERSION) +
+    (sourceMaps ? " map" : "") + (lineDirectives ? " line" : "");
+  if ((maxOutputBytes != UINT64_MAX) || (maxTotalBytes != UINT64_MAX))
+  {
+    manifestKey += " limit " + to_string(maxOutputBytes) + " " +
+      to_string(maxTotalBytes);
+  }
+  for (auto it = imports.begin(); it != imports.end(); ++it)
+  {
+    manifestKey += " import " + *it;
+  }
+  Manifest manifest(outputDirectory, manifestKey + " " + literateFile);
+  bool useManifest = streamFile.empty() && !archive && !check && !verify &&
+    libraryFile.empty() && previewBlock.empty() && (literateFile != "-");
+  if (useManifest && manifest.load() && graphFile.empty() &&
+    weaveDirectory.empty() && !profile && !utilization && manifest.isCurrent())
+  {
+    return 0;
+  }
+  Scheduler scheduler((jobs != 0) ? jobs : Scheduler::detectJobs());
+  Parser parser(scheduler);
+  parser.setKeepGoing(check);
+  parser.setStdinName(stdinName);
+  for (auto it = imports.begin(); it != imports.end(); ++it)
+  {
+    if (!parser.addLibrary(*it))
+    {
+      return -1;
+    }
   }
   Tangler tangler;
-  if (!tangler.tangle(parser.getFileBlocks(), parser.getCodeBlocks(),
-    outputDirectory))
+  tangler.setScheduler(&scheduler);
+  Profiler profiler;
+  if (profile)
+  {
+    tangler.setProfiler(&profiler);
+  }
+  OutputCache cache(cacheDirectory);
+  if (!cacheDirectory.empty() && !profile)
+  {
+    tangler.setCache(&cache);
+  }
+  pipeline = pipeline && streamFile.empty() && !archive && !check && !verify &&
+    libraryFile.empty() && previewBlock.empty() && imports.empty() &&
+    (maxOutputBytes == UINT64_MAX) && (maxTotalBytes == UINT64_MAX);
+  if (pipeline)
+  {
+    parser.setSourceCallback([&]()
+    {
+      tangler.setProvenance(parser.getSources(), parser.getImportedPaths(),
+        sourceMaps, lineDirectives);
+      vector<string> settledNames;
+      bool scanned = parser.takeSettledNames(settledNames);
+      return tangler.tangleReady(parser.getBlocks(),
+        [&](const string& name) { return parser.isFinal(name); },
+        scanned ? nullptr : &settledNames, outputDirectory,
+        useManifest ? &manifest : nullptr);
+    });
+  }
+  bool parsed = parser.parse(literateFile);
+  const BlockStore blocks = parser.releaseBlocks();
+  if (check)
+  {
+    Checker checker;
+    bool checked = checker.check(blocks, parser.getErrorCount());
+    return (parsed && checked) ? 0 : -1;
+  }
+  if (!parsed)
+  {
+    return -1;
+  }
+  if (!graphFile.empty() && !Graph::write(parser.getSources(), graphFile))
   {
     return -1;
   }
+  Estimator estimator;
+  if (!pipeline && libraryFile.empty() && previewBlock.empty())
+  {
+    estimator.estimate(blocks);
+    if (!estimator.checkLimits(maxOutputBytes, maxTotalBytes))
+    {
+      return -1;
+    }
+    tangler.setEstimator(&estimator);
+  }
+  if (verify)
+  {
+    tangler.setProvenance(parser.getSources(), parser.getImportedPaths(), false,
+      lineDirectives);
+    bool verified = tangler.verify(blocks, outputDirectory);
+    if (utilization)
+    {
+      scheduler.report(cout);
+    }
+    return verified ? 0 : -1;
+  }
+  if (!libraryFile.empty())
+  {
+    vector<const TangledBlock*> expanded;
+    vector<string> sourcePaths;
+    for (auto it = parser.getSources().begin(); it != parser.getSources().end();
+      ++it)
+    {
+      sourcePaths.push_back(it->path);
+    }
+    sourcePaths.insert(sourcePaths.end(), parser.getImportedPaths().begin(),
+      parser.getImportedPaths().end());
+    if (!tangler.expandCodeBlocks(blocks, expanded) ||
+      !Library::write(libraryFile, blocks, expanded, sourcePaths))
+    {
+      return -1;
+    }
+    return 0;
+  }
+  if (!previewBlock.empty())
+  {
+    return tangler.preview(blocks, previewBlock, previewLines, cout) ? 0 : -1;
+  }
+  tangler.setProvenance(parser.getSources(), parser.getImportedPaths(),
+    sourceMaps, lineDirectives);
+  bool tangled;
+  if (!streamFile.empty())
+  {
+    tangled = tangler.tangleToStream(blocks, streamFile, outputStream);
+  }
+  else if (archive)
+  {
+    tangled = tangler.tangleToArchive(blocks, outputStream);
+  }
+  else if (pipeline)
+  {
+    tangled = tangler.tangleReady(blocks, [](const string&) { return true; },
+      nullptr, outputDirectory, useManifest ? &manifest : nullptr);
+  }
+  else
+  {
+    tangled = tangler.tangle(blocks, outputDirectory,
+      useManifest ? &manifest : nullptr);
+  }
+  if (!tangled)
+  {
+    return -1;
+  }
+  if (profile)
+  {
+    profiler.report(blocks, cout);
+  }
+  if (useManifest)
+  {
+    manifest.setInputs(parser.getSources());
+    for (auto it = imports.begin(); it != imports.end(); ++it)
+    {
+      manifest.addInput(*it);
+    }
+    manifest.save();
+  }
+  if (!weaveDirectory.empty())
+  {
+    Weaver weaver(scheduler);
+    if (!weaver.weave(parser.getSources(), blocks, weaveDirectory))
+    {
+      return -1;
+    }
+  }
+  if (utilization)
+  {
+    scheduler.report(cout);
+  }
   return 0;
 }
 
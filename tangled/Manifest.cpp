@@ -0,0 +1,216 @@
+#include "Manifest.h"
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/types.h>
+using namespace std;
+#define MANIFEST_FILE ".lit-manifest"
+#define MANIFEST_FORMAT "lit-manifest 2"
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+Manifest::Manifest(string outputDirectory, string manifestKey) :
+  key(manifestKey),
+  startTime(time(nullptr)),
+  previousStartTime(0)
+{
+  if (!outputDirectory.empty() && (outputDirectory.back() != '/'))
+  {
+    outputDirectory += "/";
+  }
+  path = outputDirectory + MANIFEST_FILE;
+}
+
+bool Manifest::load()
+{
+  ifstream stream(path);
+  string line;
+  if (!getline(stream, line) || (line != MANIFEST_FORMAT) ||
+    !getline(stream, line) || (line != "key " + key) ||
+    !(stream >> line >> previousStartTime) || (line != "time"))
+  {
+    return false;
+  }
+  string type;
+  while (stream >> type)
+  {
+    Entry entry;
+    entry.exists = true;
+    entry.mode = 0;
+    if (type == "input")
+    {
+      stream >> entry.exists;
+    }
+    stream >> entry.size >> entry.modified;
+    if (type == "output")
+    {
+      stream >> oct >> entry.mode >> dec;
+    }
+    stream >> hex >> entry.hash >> dec;
+    string entryPath;
+    stream.get();
+    if (!getline(stream, entryPath))
+    {
+      return false;
+    }
+    (type == "input" ? inputs : outputs)[entryPath] = entry;
+  }
+  return true;
+}
+bool Manifest::isCurrent()
+{
+  if (inputs.empty())
+  {
+    return false;
+  }
+  for (auto it = inputs.begin(); it != inputs.end(); ++it)
+  {
+    Entry current;
+    statFile(it->first, current);
+    if (current.exists != it->second.exists)
+    {
+      return false;
+    }
+    if (!current.exists)
+    {
+      continue;
+    }
+    if (current.size != it->second.size)
+    {
+      return false;
+    }
+    if ((current.modified != it->second.modified) ||
+      (current.modified >= previousStartTime))
+    {
+      ifstream stream(it->first);
+      vector<string> lines;
+      string line;
+      while (getline(stream, line))
+      {
+        lines.push_back(line);
+      }
+      if (hashLines(lines) != it->second.hash)
+      {
+        return false;
+      }
+    }
+  }
+  for (auto it = outputs.begin(); it != outputs.end(); ++it)
+  {
+    Entry current;
+    if (!statFile(it->first, current) || (current.size != it->second.size) ||
+      (current.modified != it->second.modified) ||
+      (current.mode != it->second.mode))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+bool Manifest::checkOutput(string outputPath, uint64_t outputHash)
+{
+  auto it = outputs.find(outputPath);
+  Entry current;
+  if ((it == outputs.end()) || (it->second.hash != outputHash) ||
+    !statFile(outputPath, current) || (current.size != it->second.size) ||
+    (current.modified != it->second.modified) ||
+    (current.mode != it->second.mode))
+  {
+    return false;
+  }
+  newOutputs[outputPath] = it->second;
+  return true;
+}
+void Manifest::addOutput(string outputPath, uint64_t outputHash)
+{
+  Entry entry;
+  statFile(outputPath, entry);
+  entry.hash = outputHash;
+  newOutputs[outputPath] = entry;
+}
+void Manifest::setInputs(const vector<Source>& sources)
+{
+  newInputs.clear();
+  for (auto it = sources.begin(); it != sources.end(); ++it)
+  {
+    Entry entry;
+    statFile(it->path, entry);
+    entry.exists = it->found;
+    entry.hash = hashLines(it->lines);
+    newInputs[it->path] = entry;
+  }
+}
+void Manifest::addInput(string inputPath)
+{
+  Entry entry;
+  entry.exists = statFile(inputPath, entry);
+  ifstream stream(inputPath);
+  vector<string> lines;
+  string line;
+  while (getline(stream, line))
+  {
+    lines.push_back(line);
+  }
+  entry.hash = hashLines(lines);
+  newInputs[inputPath] = entry;
+}
+bool Manifest::save()
+{
+  ofstream stream(path);
+  stream << MANIFEST_FORMAT << endl;
+  stream << "key " << key << endl;
+  stream << "time " << startTime << endl;
+  for (auto it = newInputs.begin(); it != newInputs.end(); ++it)
+  {
+    stream << "input " << it->second.exists << " " << it->second.size <<
+      " " << it->second.modified << " " << hex << it->second.hash << dec <<
+      " " << it->first << endl;
+  }
+  for (auto it = newOutputs.begin(); it != newOutputs.end(); ++it)
+  {
+    stream << "output " << it->second.size << " " << it->second.modified <<
+      " " << oct << it->second.mode << " " << hex << it->second.hash << dec <<
+      " " << it->first << endl;
+  }
+  stream.close();
+  if (!stream.good())
+  {
+    cout << "Warning: Failed to write manifest '" << path << "'." << endl;
+    return false;
+  }
+  return true;
+}
+
+uint64_t Manifest::hash(const string& data)
+{
+  uint64_t value = FNV_OFFSET_BASIS;
+  for (auto it = data.begin(); it != data.end(); ++it)
+  {
+    value = (value ^ static_cast<unsigned char>(*it)) * FNV_PRIME;
+  }
+  return value;
+}
+
+uint64_t Manifest::hashLines(const vector<string>& lines)
+{
+  uint64_t value = FNV_OFFSET_BASIS;
+  for (auto it = lines.begin(); it != lines.end(); ++it)
+  {
+    for (auto charIt = it->begin(); charIt != it->end(); ++charIt)
+    {
+      value = (value ^ static_cast<unsigned char>(*charIt)) * FNV_PRIME;
+    }
+    value = (value ^ '\n') * FNV_PRIME;
+  }
+  return value;
+}
+bool Manifest::statFile(string filePath, Entry& entry)
+{
+  struct stat st;
+  entry.exists = (stat(filePath.c_str(), &st) == 0);
+  entry.size = entry.exists ? st.st_size : 0;
+  entry.modified = entry.exists ? st.st_mtime : 0;
+  entry.mode = entry.exists ? static_cast<uint32_t>(st.st_mode) : 0;
+  entry.hash = 0;
+  return entry.exists;
+}
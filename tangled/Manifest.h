@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+class Manifest
+{
+public:
+  Manifest(std::string outputDirectory, std::string key);
+
+public:
+  bool load();
+  bool isCurrent();
+  bool checkOutput(std::string path, uint64_t hash);
+  void addOutput(std::string path, uint64_t hash);
+  void setInputs(const std::vector<Source>& sources);
+  void addInput(std::string path);
+  bool save();
+
+  static uint64_t hash(const std::string& data);
+  static uint64_t hashLines(const std::vector<std::string>& lines);
+
+private:
+  struct Entry
+  {
+    bool exists;
+    uint64_t size;
+    int64_t modified;
+    uint32_t mode;
+    uint64_t hash;
+  };
+
+  static bool statFile(std::string path, Entry& entry);
+
+  std::string path;
+  std::string key;
+  time_t startTime;
+  time_t previousStartTime;
+  std::map<std::string, Entry> inputs;
+  std::map<std::string, Entry> outputs;
+  std::map<std::string, Entry> newInputs;
+  std::map<std::string, Entry> newOutputs;
+};
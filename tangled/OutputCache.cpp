@@ -0,0 +1,221 @@
+#include "OutputCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#if defined(__linux__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <unistd.h>
+#elif _WIN32
+  #include "Windows.h"
+#endif
+#if defined(__linux__)
+  #include <linux/fs.h>
+  #include <sys/ioctl.h>
+#endif
+using namespace std;
+#define CACHE_FIRST_BASIS 14695981039346656037ULL
+#define CACHE_SECOND_BASIS 0x62b821756295c58dULL
+#define CACHE_PRIME 1099511628211ULL
+#define CACHE_SECOND_PRIME 0x9e3779b185ebca87ULL
+#define CACHE_VERSION "LITCACHE3"
+#define CACHE_TRAILER_MARKER "\nLITENTRY"
+#define CACHE_TRAILER_SIZE (9 + 3 * 16)
+#define KEY_UNKNOWN 0
+#define KEY_PENDING 1
+#define KEY_KNOWN 2
+
+OutputCache::OutputCache(string cacheDirectory) :
+  directory(cacheDirectory),
+  lineDirectives(false),
+  sourcePaths(nullptr)
+{
+  if (directory.empty() || (directory.back() != '/'))
+  {
+    directory += "/";
+  }
+}
+
+void OutputCache::reset(size_t codeBlockCount)
+{
+  codeHashes.assign(codeBlockCount, Hash{0, 0});
+  codeStates.assign(codeBlockCount, KEY_UNKNOWN);
+}
+bool OutputCache::makeKey(const BlockStore& blocks, const FileBlock& fileBlock,
+  bool directives, const vector<string>& paths, string& key)
+{
+  lineDirectives = directives;
+  sourcePaths = &paths;
+  Hash hash{CACHE_FIRST_BASIS, CACHE_SECOND_BASIS};
+  mix(hash, string(CACHE_VERSION) + (directives ? " line" : ""));
+  if (!hashBlock(blocks, &fileBlock, hash))
+  {
+    return false;
+  }
+  char digits[33];
+  snprintf(digits, sizeof(digits), "%016llx%016llx",
+    static_cast<unsigned long long>(hash.first),
+    static_cast<unsigned long long>(hash.second));
+  key = digits;
+  return true;
+}
+bool OutputCache::hashBlock(const BlockStore& blocks, const Block* block,
+  Hash& hash)
+{
+  const vector<string>& lines = block->getLines();
+  const vector<LineOrigin>& origins = block->getOrigins();
+  for (size_t index = 0; index < lines.size(); ++index)
+  {
+    string whitespace, name;
+    if ((lines[index].find("@{") == string::npos) ||
+      !Block::parseReference(lines[index], whitespace, name))
+    {
+      mix(hash, "L" + lines[index] + '\n');
+      if (lineDirectives)
+      {
+        const LineOrigin& origin = origins[index];
+        mix(hash, ((origin.source < sourcePaths->size()) ?
+          (*sourcePaths)[origin.source] : string()) + ":" +
+          to_string(origin.line) + '\n');
+      }
+      continue;
+    }
+    uint32_t childIndex;
+    if (!blocks.findCodeBlock(name, childIndex))
+    {
+      cout << "Error: Unable to find block '" << name << "'." << endl;
+      return false;
+    }
+    if (codeStates[childIndex] == KEY_PENDING)
+    {
+      cout << "Error: Reference cycle through block '" << name << "'." << endl;
+      return false;
+    }
+    if (codeStates[childIndex] == KEY_UNKNOWN)
+    {
+      codeStates[childIndex] = KEY_PENDING;
+      Hash childHash{CACHE_FIRST_BASIS, CACHE_SECOND_BASIS};
+      if (!hashBlock(blocks, &blocks.getCodeBlocks()[childIndex], childHash))
+      {
+        return false;
+      }
+      codeHashes[childIndex] = childHash;
+      codeStates[childIndex] = KEY_KNOWN;
+    }
+    const Hash& childHash = codeHashes[childIndex];
+    mix(hash, "R" + whitespace + '\n' + to_string(childHash.first) + ":" +
+      to_string(childHash.second) + '\n');
+  }
+  return true;
+}
+void OutputCache::mix(Hash& hash, const string& data)
+{
+  for (auto it = data.begin(); it != data.end(); ++it)
+  {
+    uint64_t byte = static_cast<unsigned char>(*it);
+    hash.first = (hash.first ^ byte) * CACHE_PRIME;
+    hash.second = (hash.second + byte) * CACHE_SECOND_PRIME;
+    hash.second ^= hash.second >> 29;
+  }
+}
+
+string OutputCache::getEntryPath(const string& key) const
+{
+  return directory + key.substr(0, 2) + "/" + key.substr(2);
+}
+string OutputCache::makeTrailer(const string& contents)
+{
+  Hash hash{CACHE_FIRST_BASIS, CACHE_SECOND_BASIS};
+  mix(hash, contents);
+  char digits[3 * 16 + 1];
+  snprintf(digits, sizeof(digits), "%016llx%016llx%016llx",
+    static_cast<unsigned long long>(contents.size()),
+    static_cast<unsigned long long>(hash.first),
+    static_cast<unsigned long long>(hash.second));
+  return string(CACHE_TRAILER_MARKER) + digits;
+}
+bool OutputCache::fetch(const string& key, string& contents)
+{
+  string entryPath = getEntryPath(key);
+  ifstream stream(entryPath, ios::binary);
+  if (!stream.good())
+  {
+    return false;
+  }
+  stringstream entry;
+  entry << stream.rdbuf();
+  contents = entry.str();
+  size_t length = contents.size() - min(contents.size(),
+    static_cast<size_t>(CACHE_TRAILER_SIZE));
+  if ((contents.size() < CACHE_TRAILER_SIZE) ||
+    (contents.compare(length, string::npos,
+    makeTrailer(contents.substr(0, length))) != 0))
+  {
+    cout << "Warning: Ignoring corrupt cache entry '" << entryPath << "'." <<
+      endl;
+    contents.clear();
+    return false;
+  }
+  contents.resize(length);
+  return true;
+}
+void OutputCache::store(const string& key, const string& contents)
+{
+  string entryPath = getEntryPath(key);
+  size_t position = entryPath.find('/', 1);
+  while (position != string::npos)
+  {
+    string parent = entryPath.substr(0, position);
+#if defined(__linux__) || defined(__APPLE__)
+    mkdir(parent.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+#elif _WIN32
+    CreateDirectoryA(parent.c_str(), NULL);
+#endif
+    position = entryPath.find('/', position + 1);
+  }
+#if defined(__linux__) || defined(__APPLE__)
+  string temporaryPath = entryPath + ".tmp" + to_string(getpid());
+#elif _WIN32
+  string temporaryPath = entryPath + ".tmp" + to_string(GetCurrentProcessId());
+  remove(entryPath.c_str());
+#endif
+  ofstream stream(temporaryPath, ios::binary);
+  stream << contents << makeTrailer(contents);
+  stream.close();
+  if (!stream.good() || (rename(temporaryPath.c_str(), entryPath.c_str()) != 0))
+  {
+    remove(temporaryPath.c_str());
+    cout << "Warning: Failed to add '" << entryPath << "' to the cache." <<
+      endl;
+  }
+}
+bool OutputCache::clone(const string& sourcePath, const string& destinationPath,
+  uint64_t length)
+{
+#if defined(__linux__) && defined(FICLONE)
+  int source = open(sourcePath.c_str(), O_RDONLY);
+  if (source < 0)
+  {
+    return false;
+  }
+  int destination = open(destinationPath.c_str(), O_WRONLY | O_CREAT |
+    O_TRUNC, 0666);
+  bool cloned = (destination >= 0) &&
+    (ioctl(destination, FICLONE, source) == 0) &&
+    (ftruncate(destination, static_cast<off_t>(length)) == 0);
+  if (destination >= 0)
+  {
+    close(destination);
+  }
+  close(source);
+  return cloned;
+#else
+  (void)sourcePath;
+  (void)destinationPath;
+  (void)length;
+  return false;
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockStore.h"
+
+class OutputCache
+{
+public:
+  OutputCache(std::string directory);
+
+public:
+  void reset(size_t codeBlockCount);
+  bool makeKey(const BlockStore& blocks, const FileBlock& fileBlock,
+    bool lineDirectives, const std::vector<std::string>& sourcePaths,
+    std::string& key);
+  bool fetch(const std::string& key, std::string& contents);
+  void store(const std::string& key, const std::string& contents);
+  std::string getEntryPath(const std::string& key) const;
+  static bool clone(const std::string& sourcePath,
+    const std::string& destinationPath, uint64_t length);
+
+private:
+  struct Hash
+  {
+    uint64_t first;
+    uint64_t second;
+  };
+
+  bool hashBlock(const BlockStore& blocks, const Block* block, Hash& hash);
+  static void mix(Hash& hash, const std::string& data);
+  static std::string makeTrailer(const std::string& contents);
+
+  std::string directory;
+  bool lineDirectives;
+  const std::vector<std::string>* sourcePaths;
+  std::vector<Hash> codeHashes;
+  std::vector<uint8_t> codeStates;
+};
@@ -1,64 +1,142 @@
 #include "Parser.h"
+#include <cctype>
+#include <chrono>
 #include <deque>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <list>
-#include <regex>
+#include <sstream>
+#include <unordered_set>
+#include "Prefetcher.h"
 using namespace std;
+#define STDIN_SOURCE "-"
 
-Parser::~Parser()
+Parser::Parser(Scheduler& scheduler) :
+  prefetcher(scheduler)
 {
-  for (auto it = fileBlocks.begin(); it != fileBlocks.end(); ++it)
-  {
-    delete it->second;
-  }
-  fileBlocks.clear();
-  for (auto it = codeBlocks.begin(); it != codeBlocks.end(); ++it)
-  {
-    delete it->second;
-  }
-  codeBlocks.clear();
+}
+BlockStore Parser::releaseBlocks()
+{
+  return move(blocks);
 }
 
-map<string, FileBlock*> Parser::getFileBlocks()
+const BlockStore& Parser::getBlocks() const
 {
-  return fileBlocks;
+  return blocks;
 }
 
-map<string, CodeBlock*> Parser::getCodeBlocks()
+const vector<Source>& Parser::getSources()
+{
+  return sources;
+}
+void Parser::setKeepGoing(bool value)
 {
-  return codeBlocks;
+  keepGoing = value;
+}
+
+uint32_t Parser::getErrorCount() const
+{
+  return errorCount;
+}
+void Parser::setSourceCallback(function<bool()> callback)
+{
+  sourceCallback = callback;
+}
+
+bool Parser::isFinal(const string& name)
+{
+  return prefetcher.isSettled(name);
+}
+
+bool Parser::takeSettledNames(vector<string>& names)
+{
+  return prefetcher.takeSettled(names);
+}
+void Parser::setMemorySources(const unordered_map<string, string>* sources)
+{
+  memorySources = sources;
+}
+void Parser::setStdinName(const string& name)
+{
+  stdinName = name;
 }
 
 bool Parser::parse(std::string literateFile)
 {
-  deque<string> unprocessedSources, processedSources;
+  deque<string> unprocessedSources;
+  unordered_set<string> discoveredSources;
+  bool readStdin = (literateFile == STDIN_SOURCE);
+  if (readStdin && !stdinName.empty())
+  {
+    literateFile = stdinName;
+  }
+  if (literateFile != STDIN_SOURCE)
+  {
+    literateFile = normalizePath(literateFile);
+  }
+  if (readStdin)
+  {
+    stdinSource = literateFile;
+    prefetcher.ignore(literateFile);
+  }
+  else if (memorySources == nullptr)
+  {
+    prefetcher.request(literateFile);
+  }
   unprocessedSources.push_back(literateFile);
+  discoveredSources.insert(literateFile);
   while (!unprocessedSources.empty())
   {
+    Source record;
+    record.path = unprocessedSources.front();
+    uint32_t sourceIndex = static_cast<uint32_t>(sources.size());
+    unordered_set<string> linkedSources;
+    auto startTime = chrono::steady_clock::now();
     string source = unprocessedSources.front();
-    ifstream sourceStream(source);
-    if (!sourceStream.good())
+    vector<string> lines;
+    string line;
+    bool found = true;
+    if (source == stdinSource)
+    {
+      while (getline(cin, line))
+      {
+        lines.push_back(line);
+      }
+    }
+    else if (memorySources != nullptr)
+    {
+      auto it = memorySources->find(source);
+      found = (it != memorySources->end());
+      istringstream stream(found ? it->second : string());
+      while (getline(stream, line))
+      {
+        lines.push_back(line);
+      }
+    }
+    else
+    {
+      found = prefetcher.take(source, lines);
+    }
+    if (!found)
     {
       cout << "Warning: File \"" << source << "\" not found, skipping." << endl;
+      record.parseMicroseconds = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - startTime).count();
+      sources.push_back(move(record));
       unprocessedSources.pop_front();
-      processedSources.push_back(source);
       continue;
     }
-    vector<string> lines;
-    string line;
-    while (getline(sourceStream, line))
-    {
-      lines.push_back(line);
-    }
-    sourceStream.close();
+    record.found = true;
+    record.lineCount = static_cast<uint32_t>(lines.size());
     string rootDirectory;
     size_t index = source.rfind("/");
     if (index != string::npos)
     {
       rootDirectory = source.substr(0, index + 1);
     }
+    FileBlock fileBlock(source, 0);
+    CodeBlock codeBlock(source, 0);
     Block* block = nullptr;
     bool isBlockFile = false;
     for (uint32_t lineNumber = 0; lineNumber < lines.size(); ++lineNumber)
@@ -69,23 +147,35 @@ bool Parser::parse(std::string literateFile)
         if ((lineNumber + 1) < lines.size())
         {
           string nextLine = lines[lineNumber + 1];
+          bool parsedHeader = false;
           if (FileBlock::checkStart(line, nextLine))
           {
-            block = new FileBlock(source, lineNumber);
+            fileBlock = FileBlock(source, lineNumber);
+            parsedHeader = fileBlock.parseHeader(line);
+            block = &fileBlock;
             isBlockFile = true;
           }
           else if (CodeBlock::checkStart(line, nextLine))
           {
-            block = new CodeBlock(source, lineNumber);
+            codeBlock = CodeBlock(source, lineNumber);
+            parsedHeader = codeBlock.parseHeader(line);
+            block = &codeBlock;
             isBlockFile = false;
           }
           if (block != nullptr)
           {
-            if (!block->parseHeader(line))
+            record.blockCount += 1;
+            if (!parsedHeader)
             {
               cout << "Error: Failed to parse block header in line " <<
                 to_string(lineNumber) << " of file \"" << source << "\"." << endl;
-              return false;
+              errorCount += 1;
+              if (!keepGoing)
+              {
+                return false;
+              }
+              block = nullptr;
+              continue;
             }
             lineNumber += 1;
             continue;
@@ -93,29 +183,22 @@ bool Parser::parse(std::string literateFile)
         }
         if (block == nullptr)
         {
-          regex linkRegEx("\\[\\w+\\]\\((.*?\\.md)\\)");
-          smatch results;
-          string::const_iterator matchStart(line.cbegin());
-          while (regex_search(matchStart, line.cend(), results, linkRegEx))
+          vector<string> links;
+          findLinks(line, rootDirectory, links);
+          for (auto it = links.begin(); it != links.end(); ++it)
           {
-            if (results.size() == 2)
+            if (linkedSources.insert(*it).second)
+            {
+              record.links.push_back(*it);
+            }
+            if (discoveredSources.insert(*it).second)
             {
-              string path = results[1];
-              if ((path.rfind("http://", 0) != 0) &&
-                (path.rfind("https://", 0) != 0) &&
-                (path.rfind("ftp://", 0) != 0))
+              unprocessedSources.push_back(*it);
+              if (memorySources == nullptr)
               {
-                string fullPath = rootDirectory + path;
-                if ((find(unprocessedSources.begin(), unprocessedSources.end(),
-                  fullPath) == unprocessedSources.end()) && 
-                  (find(processedSources.begin(), processedSources.end(),
-                  fullPath) == processedSources.end()))
-                {
-                  unprocessedSources.push_back(fullPath);
-                }
+                prefetcher.request(*it);
               }
             }
-            matchStart = results.suffix().first;
           }
         }
       }
@@ -123,66 +206,277 @@ bool Parser::parse(std::string literateFile)
       {
         if (!block->checkEnd(line))
         {
-          block->addLine(line);
+          block->addLine(move(line), LineOrigin{sourceIndex, lineNumber});
           continue;
         }
         if (isBlockFile)
         {
-          auto existingBlockIt = fileBlocks.find(block->getName());
-          if (existingBlockIt != fileBlocks.end())
+          uint32_t existingIndex;
+          if (blocks.findFileBlock(fileBlock.getName(), existingIndex))
           {
-            FileBlock* existingBlock = existingBlockIt->second;
-            cout << "Error: Duplicate file block \"" << block->getName() <<
+            FileBlock& existingBlock = blocks.getFileBlocks()[existingIndex];
+            cout << "Error: Duplicate file block \"" << fileBlock.getName() <<
               "\" in line " << to_string(lineNumber) << " of file \"" << source <<
-              "\", previously encountered in line " << existingBlock->getSourceLine() <<
-              " of file \"" << existingBlock->getSourceFile() << "\"." << endl;
-            return false;
+              "\", previously encountered in line " << existingBlock.getSourceLine() <<
+              " of file \"" << existingBlock.getSourceFile() << "\"." << endl;
+            errorCount += 1;
+            if (!keepGoing)
+            {
+              return false;
+            }
+            block = nullptr;
+            continue;
           }
-          fileBlocks.insert(make_pair(block->getName(),
-            dynamic_cast<FileBlock*>(block)));
+          blocks.addFileBlock(move(fileBlock));
           block = nullptr;
         }
         else
         {
-          CodeBlock* codeBlock = dynamic_cast<CodeBlock*>(block);
-          if (codeBlock->getAppend())
+          uint32_t existingIndex;
+          bool exists = blocks.findCodeBlock(codeBlock.getName(), existingIndex);
+          if (codeBlock.getAppend())
           {
-            map<string, CodeBlock*>::iterator it = codeBlocks.find(codeBlock->getName());
-            if (it == codeBlocks.end())
+            if (!exists)
             {
               cout << "Error: Cannot append to non-existent code block \"" <<
-                block->getName() << "\" in line " << to_string(lineNumber) <<
+                codeBlock.getName() << "\" in line " << to_string(lineNumber) <<
                 " of file \"" << source << "\"." << endl;
-              return false;
-            }
-            CodeBlock* existingBlock = it->second;
-            vector<string> newLines = codeBlock->getLines();
-            for (vector<string>::iterator lineIt = newLines.begin();
-              lineIt != newLines.end(); ++lineIt)
-            {
-              existingBlock->addLine(*lineIt);
+              errorCount += 1;
+              if (!keepGoing)
+              {
+                return false;
+              }
+              block = nullptr;
+              continue;
             }
-            delete block;
+            blocks.getCodeBlocks()[existingIndex].appendBlock(move(codeBlock));
             block = nullptr;
           }
           else
           {
-            if (codeBlocks.find(block->getName()) != codeBlocks.end())
+            if (exists)
             {
-              cout << "Error: Duplicate code block \"" << block->getName() <<
+              cout << "Error: Duplicate code block \"" << codeBlock.getName() <<
                 "\" in line " << to_string(lineNumber) << " of file \"" << source <<
                 "\"." << endl;
-              return false;
+              errorCount += 1;
+              if (!keepGoing)
+              {
+                return false;
+              }
+              block = nullptr;
+              continue;
             }
-            codeBlocks.insert(make_pair(block->getName(),
-              dynamic_cast<CodeBlock*>(block)));
+            blocks.addCodeBlock(move(codeBlock));
             block = nullptr;
           }
         }
       }
     }
+    record.lines = move(lines);
+    record.parseMicroseconds = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - startTime).count();
+    sources.push_back(move(record));
     unprocessedSources.pop_front();
-    processedSources.push_back(source);
+    if (sourceCallback && !sourceCallback())
+    {
+      return false;
+    }
   }
+  importBlocks();
+  return (errorCount == 0);
+}
+bool Parser::addLibrary(string path)
+{
+  unique_ptr<Library> library(new Library());
+  if (!library->open(path))
+  {
+    return false;
+  }
+  libraries.push_back(move(library));
   return true;
 }
+
+const vector<string>& Parser::getImportedPaths() const
+{
+  return importedPaths;
+}
+void Parser::importBlocks()
+{
+  vector<uint32_t> sourceBases;
+  for (auto it = libraries.begin(); it != libraries.end(); ++it)
+  {
+    sourceBases.push_back(static_cast<uint32_t>(sources.size() +
+      importedPaths.size()));
+    importedPaths.insert(importedPaths.end(), (*it)->getSourcePaths().begin(),
+      (*it)->getSourcePaths().end());
+  }
+  uint32_t fileCount = static_cast<uint32_t>(blocks.getFileBlocks().size());
+  vector<bool> isExpanded(blocks.getCodeBlocks().size(), false);
+  for (uint32_t index = 0; !libraries.empty() &&
+    (index < fileCount + blocks.getCodeBlocks().size()); ++index)
+  {
+    if ((index >= fileCount) && isExpanded[index - fileCount])
+    {
+      continue;
+    }
+    const Block& block = (index < fileCount) ?
+      static_cast<const Block&>(blocks.getFileBlocks()[index]) :
+      static_cast<const Block&>(blocks.getCodeBlocks()[index - fileCount]);
+    vector<string> names;
+    for (auto it = block.getLines().begin(); it != block.getLines().end(); ++it)
+    {
+      string whitespace, name;
+      uint32_t existingIndex;
+      if ((it->find("@{") != string::npos) &&
+        Block::parseReference(*it, whitespace, name) &&
+        !blocks.findCodeBlock(name, existingIndex))
+      {
+        names.push_back(name);
+      }
+    }
+    for (auto it = names.begin(); it != names.end(); ++it)
+    {
+      uint32_t existingIndex;
+      if (blocks.findCodeBlock(*it, existingIndex))
+      {
+        continue;
+      }
+      for (size_t library = 0; library < libraries.size(); ++library)
+      {
+        CodeBlock imported("", 0);
+        bool expanded;
+        if (libraries[library]->importBlock(*it, sourceBases[library], imported,
+          expanded))
+        {
+          blocks.addCodeBlock(move(imported));
+          isExpanded.push_back(expanded);
+          break;
+        }
+      }
+    }
+  }
+}
+
+void Parser::findLinks(const string& line, const string& rootDirectory,
+  vector<string>& links)
+{
+  if (line.find(".md)") == string::npos)
+  {
+    return;
+  }
+  size_t position = 0;
+  while ((position = line.find('[', position)) != string::npos)
+  {
+    size_t textEnd = position + 1;
+    while ((textEnd < line.size()) && ((line[textEnd] == '_') ||
+      isalnum(static_cast<unsigned char>(line[textEnd]))))
+    {
+      ++textEnd;
+    }
+    if ((textEnd == position + 1) || (line.compare(textEnd, 2, "](") != 0))
+    {
+      ++position;
+      continue;
+    }
+    size_t pathStart = textEnd + 2;
+    size_t pathEnd = line.find(".md)", pathStart);
+    if (pathEnd == string::npos)
+    {
+      return;
+    }
+    size_t terminator = line.find_first_of("\r\n", pathStart);
+    if (terminator < pathEnd)
+    {
+      position = terminator;
+      continue;
+    }
+    string path = line.substr(pathStart, pathEnd + 3 - pathStart);
+    if ((path.rfind("http://", 0) != 0) &&
+      (path.rfind("https://", 0) != 0) &&
+      (path.rfind("ftp://", 0) != 0))
+    {
+      links.push_back(normalizePath(rootDirectory + path));
+    }
+    position = pathEnd + 4;
+  }
+}
+void Parser::scanSource(const string& source, const vector<string>& lines,
+  vector<string>& links, vector<string>& blockNames)
+{
+  string rootDirectory;
+  size_t index = source.rfind("/");
+  if (index != string::npos)
+  {
+    rootDirectory = source.substr(0, index + 1);
+  }
+  bool inBlock = false;
+  for (uint32_t lineNumber = 0; lineNumber < lines.size(); ++lineNumber)
+  {
+    const string& line = lines[lineNumber];
+    if (inBlock)
+    {
+      inBlock = (line != BLOCK_DELIMITER);
+      continue;
+    }
+    if ((lineNumber + 1) < lines.size())
+    {
+      const string& nextLine = lines[lineNumber + 1];
+      if (FileBlock::checkStart(line, nextLine) ||
+        CodeBlock::checkStart(line, nextLine))
+      {
+        if (CodeBlock::checkStart(line, nextLine))
+        {
+          CodeBlock header(source, lineNumber);
+          header.parseHeader(line);
+          blockNames.push_back(header.getName());
+        }
+        inBlock = true;
+        lineNumber += 1;
+        continue;
+      }
+    }
+    findLinks(line, rootDirectory, links);
+  }
+}
+string Parser::normalizePath(string path)
+{
+  bool absolute = (!path.empty() && (path[0] == '/'));
+  vector<string> components;
+  size_t start = 0;
+  while (start <= path.size())
+  {
+    size_t end = path.find("/", start);
+    if (end == string::npos)
+    {
+      end = path.size();
+    }
+    string component = path.substr(start, end - start);
+    if (component == "..")
+    {
+      if (!components.empty() && (components.back() != ".."))
+      {
+        components.pop_back();
+      }
+      else if (!absolute)
+      {
+        components.push_back(component);
+      }
+    }
+    else if (!component.empty() && (component != "."))
+    {
+      components.push_back(component);
+    }
+    start = end + 1;
+  }
+  string normalized = absolute ? "/" : "";
+  for (auto it = components.begin(); it != components.end(); ++it)
+  {
+    if (it != components.begin())
+    {
+      normalized += "/";
+    }
+    normalized += *it;
+  }
+  return normalized;
+}
@@ -1,21 +1,66 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
-#include "CodeBlock.h"
-#include "FileBlock.h"
+#include <unordered_map>
+#include <vector>
+#include "BlockStore.h"
+#include "Library.h"
+#include "Prefetcher.h"
+
+struct Source
+{
+  std::string path;
+  bool found = false;
+  std::vector<std::string> links;
+  uint32_t lineCount = 0;
+  uint32_t blockCount = 0;
+  uint64_t parseMicroseconds = 0;
+  std::vector<std::string> lines;
+};
 
 class Parser
 {
 public:
-  virtual ~Parser();
+  Parser(Scheduler& scheduler);
 
 public:
   bool parse(std::string literateFile);
-  std::map<std::string, FileBlock*> getFileBlocks();
-  std::map<std::string, CodeBlock*> getCodeBlocks();
+  BlockStore releaseBlocks();
+  const BlockStore& getBlocks() const;
+  const std::vector<Source>& getSources();
+  void setKeepGoing(bool value);
+  uint32_t getErrorCount() const;
+  void setSourceCallback(std::function<bool()> callback);
+  void setMemorySources(
+    const std::unordered_map<std::string, std::string>* sources);
+  void setStdinName(const std::string& name);
+  bool isFinal(const std::string& name);
+  bool takeSettledNames(std::vector<std::string>& names);
+  bool addLibrary(std::string path);
+  const std::vector<std::string>& getImportedPaths() const;
+
+  static void findLinks(const std::string& line,
+    const std::string& rootDirectory, std::vector<std::string>& links);
+  static void scanSource(const std::string& source,
+    const std::vector<std::string>& lines, std::vector<std::string>& links,
+    std::vector<std::string>& blockNames);
 
 private:
-  std::map<std::string, FileBlock*> fileBlocks;
-  std::map<std::string, CodeBlock*> codeBlocks;
+  static std::string normalizePath(std::string path);
+  void importBlocks();
+
+  BlockStore blocks;
+  std::vector<Source> sources;
+  bool keepGoing = false;
+  uint32_t errorCount = 0;
+  std::function<bool()> sourceCallback;
+  const std::unordered_map<std::string, std::string>* memorySources = nullptr;
+  std::string stdinName;
+  std::string stdinSource;
+  Prefetcher prefetcher;
+  std::vector<std::unique_ptr<Library>> libraries;
+  std::vector<std::string> importedPaths;
 };
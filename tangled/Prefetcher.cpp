@@ -0,0 +1,144 @@
+#include "Prefetcher.h"
+#include <fstream>
+#include "Parser.h"
+#if defined(__linux__)
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+using namespace std;
+
+Prefetcher::Prefetcher(Scheduler& readScheduler) :
+  scheduler(readScheduler),
+  readingCount(0),
+  scanCount(0),
+  takenScanCount(0),
+  stopping(false)
+{
+}
+Prefetcher::~Prefetcher()
+{
+  unique_lock<mutex> lock(resultsMutex);
+  stopping = true;
+  condition.wait(lock, [&]() { return readingCount == 0; });
+}
+
+void Prefetcher::request(string path)
+{
+  {
+    lock_guard<mutex> lock(resultsMutex);
+    if (!requested.insert(path).second)
+    {
+      return;
+    }
+    enqueue(path);
+  }
+  advise(path);
+}
+void Prefetcher::enqueue(const string& path)
+{
+  results[path];
+  readingCount += 1;
+  scheduler.submit([this, path]() { read(path); });
+}
+void Prefetcher::advise(const string& path)
+{
+#if defined(__linux__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+  }
+#else
+  (void)path;
+#endif
+}
+void Prefetcher::ignore(string path)
+{
+  lock_guard<mutex> lock(resultsMutex);
+  requested.insert(path);
+}
+bool Prefetcher::take(string path, vector<string>& lines)
+{
+  unique_lock<mutex> lock(resultsMutex);
+  if (results.count(path) == 0)
+  {
+    requested.insert(path);
+    enqueue(path);
+  }
+  auto it = results.find(path);
+  condition.wait(lock, [&]() { return it->second.done; });
+  bool found = it->second.found;
+  lines = move(it->second.lines);
+  for (auto nameIt = it->second.blockNames.begin();
+    nameIt != it->second.blockNames.end(); ++nameIt)
+  {
+    if (--pendingBlocks[*nameIt] == 0)
+    {
+      settledNames.push_back(*nameIt);
+    }
+  }
+  results.erase(it);
+  return found;
+}
+bool Prefetcher::isSettled(const string& blockName)
+{
+  lock_guard<mutex> lock(resultsMutex);
+  if (readingCount > 0)
+  {
+    return false;
+  }
+  auto it = pendingBlocks.find(blockName);
+  return (it == pendingBlocks.end()) || (it->second == 0);
+}
+bool Prefetcher::takeSettled(vector<string>& blockNames)
+{
+  lock_guard<mutex> lock(resultsMutex);
+  blockNames = move(settledNames);
+  settledNames.clear();
+  bool scanned = (scanCount != takenScanCount);
+  takenScanCount = scanCount;
+  return scanned;
+}
+void Prefetcher::read(string path)
+{
+  vector<string> lines;
+  ifstream stream(path);
+  bool found = stream.good();
+  string line;
+  while (getline(stream, line))
+  {
+    lines.push_back(line);
+  }
+  vector<string> links, blockNames;
+  Parser::scanSource(path, lines, links, blockNames);
+  unique_lock<mutex> lock(resultsMutex);
+  for (auto it = blockNames.begin(); it != blockNames.end(); ++it)
+  {
+    pendingBlocks[*it] += 1;
+  }
+  vector<string> newLinks;
+  for (auto it = links.begin(); (it != links.end()) && !stopping; ++it)
+  {
+    if (requested.insert(*it).second)
+    {
+      enqueue(*it);
+      newLinks.push_back(*it);
+    }
+  }
+  Result& result = results[path];
+  result.found = found;
+  result.lines = move(lines);
+  result.blockNames = move(blockNames);
+  result.done = true;
+  if (--readingCount == 0)
+  {
+    scanCount += 1;
+  }
+  condition.notify_all();
+  lock.unlock();
+  for (auto it = newLinks.begin(); it != newLinks.end(); ++it)
+  {
+    advise(*it);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Scheduler.h"
+
+class Prefetcher
+{
+public:
+  Prefetcher(Scheduler& scheduler);
+  virtual ~Prefetcher();
+
+public:
+  void request(std::string path);
+  void ignore(std::string path);
+  bool take(std::string path, std::vector<std::string>& lines);
+  bool isSettled(const std::string& blockName);
+  bool takeSettled(std::vector<std::string>& blockNames);
+
+private:
+  struct Result
+  {
+    bool done = false;
+    bool found = false;
+    std::vector<std::string> lines;
+    std::vector<std::string> blockNames;
+  };
+
+  void read(std::string path);
+  void enqueue(const std::string& path);
+  static void advise(const std::string& path);
+
+  Scheduler& scheduler;
+  std::mutex resultsMutex;
+  std::condition_variable condition;
+  std::unordered_map<std::string, Result> results;
+  std::unordered_set<std::string> requested;
+  std::unordered_map<std::string, uint32_t> pendingBlocks;
+  std::vector<std::string> settledNames;
+  uint32_t readingCount;
+  uint32_t scanCount;
+  uint32_t takenScanCount;
+  bool stopping;
+};
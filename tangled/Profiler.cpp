@@ -0,0 +1,84 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+using namespace std;
+
+void Profiler::addTime(uint32_t codeIndex, chrono::steady_clock::duration time)
+{
+  if (codeIndex >= times.size())
+  {
+    times.resize(codeIndex + 1, chrono::steady_clock::duration::zero());
+  }
+  times[codeIndex] += time;
+}
+void Profiler::report(const BlockStore& blocks, ostream& stream)
+{
+  Estimator estimator;
+  estimator.estimate(blocks);
+  nodes.assign(estimator.getNodeCount(), Node());
+  countAppearances(estimator,
+    static_cast<uint32_t>(blocks.getFileBlocks().size()));
+  uint32_t codeCount = static_cast<uint32_t>(blocks.getCodeBlocks().size());
+  times.resize(codeCount, chrono::steady_clock::duration::zero());
+  vector<uint32_t> rows;
+  for (uint32_t index = 0; index < codeCount; ++index)
+  {
+    rows.push_back(index);
+  }
+  sort(rows.begin(), rows.end(), [&](uint32_t left, uint32_t right)
+  {
+    if (nodes[left].totalBytes != nodes[right].totalBytes)
+    {
+      return nodes[left].totalBytes > nodes[right].totalBytes;
+    }
+    if (times[left] != times[right])
+    {
+      return times[left] > times[right];
+    }
+    return blocks.getCodeBlocks()[left].getName() <
+      blocks.getCodeBlocks()[right].getName();
+  });
+  stream << setw(8) << "Refs" << setw(12) << "Lines" << setw(14) << "Bytes" <<
+    setw(12) << "Time (ms)" << "  Block" << endl;
+  for (auto it = rows.begin(); it != rows.end(); ++it)
+  {
+    const Node& node = nodes[*it];
+    stream << setw(8) << node.referenceCount <<
+      setw(12) << node.totalLines << setw(14) << node.totalBytes <<
+      setw(12) << fixed << setprecision(3) <<
+      chrono::duration<double, milli>(times[*it]).count() <<
+      "  " << blocks.getCodeBlocks()[*it].getName() << endl;
+  }
+}
+void Profiler::countAppearances(const Estimator& estimator, uint32_t fileCount)
+{
+  for (uint32_t index = static_cast<uint32_t>(nodes.size()) - fileCount;
+    index < nodes.size(); ++index)
+  {
+    nodes[index].appearances = 1;
+  }
+  const vector<uint32_t>& order = estimator.getOrder();
+  for (auto it = order.begin(); it != order.end(); ++it)
+  {
+    const Node& node = nodes[*it];
+    const vector<Estimator::Reference>& references =
+      estimator.getReferences(*it);
+    for (auto refIt = references.begin(); refIt != references.end(); ++refIt)
+    {
+      Node& child = nodes[refIt->child];
+      child.referenceCount += 1;
+      child.appearances = Estimator::add(child.appearances, node.appearances);
+      child.indent = Estimator::add(child.indent, Estimator::add(node.indent,
+        Estimator::multiply(refIt->indent, node.appearances)));
+    }
+  }
+  for (uint32_t index = 0; index < nodes.size(); ++index)
+  {
+    uint64_t lines = estimator.getLines(index);
+    nodes[index].totalLines = Estimator::multiply(lines,
+      nodes[index].appearances);
+    nodes[index].totalBytes = Estimator::add(Estimator::multiply(
+      estimator.getBytes(index), nodes[index].appearances),
+      Estimator::multiply(nodes[index].indent, lines));
+  }
+}
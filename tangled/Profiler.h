@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "BlockStore.h"
+#include "Estimator.h"
+
+class Profiler
+{
+public:
+  void addTime(uint32_t codeIndex, std::chrono::steady_clock::duration time);
+  void report(const BlockStore& blocks, std::ostream& stream);
+
+private:
+  struct Node
+  {
+    uint32_t referenceCount = 0;
+    uint64_t appearances = 0;
+    uint64_t indent = 0;
+    uint64_t totalLines = 0;
+    uint64_t totalBytes = 0;
+  };
+
+  void countAppearances(const Estimator& estimator, uint32_t fileCount);
+
+  std::vector<Node> nodes;
+  std::vector<std::chrono::steady_clock::duration> times;
+};
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Fuzz.h"
+using namespace std;
+#define REPLAY_LIMIT_MS 2000
+#define REPLAY_EXPECTED ".expected"
+
+static bool readFile(const string& path, string& contents)
+{
+  ifstream stream(path, ios::binary);
+  if (!stream.good())
+  {
+    return false;
+  }
+  stringstream buffer;
+  buffer << stream.rdbuf();
+  contents = buffer.str();
+  return true;
+}
+int main(int argc, char** argv)
+{
+  bool check = (argc > 1) && (string(argv[1]) == "--check");
+  int first = check ? 2 : 1;
+  if (argc <= first)
+  {
+    cout << "Usage: lit-replay [--check] FILE..." << endl;
+    return -1;
+  }
+  bool passed = true;
+  for (int index = first; index < argc; ++index)
+  {
+    string input;
+    if (!readFile(argv[index], input))
+    {
+      cout << "Error: Failed to read '" << argv[index] << "'." << endl;
+      passed = false;
+      continue;
+    }
+    auto start = chrono::steady_clock::now();
+    string summary = testInput(reinterpret_cast<const uint8_t*>(input.data()),
+      input.size());
+    long long elapsed = chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start).count();
+    cout << argv[index] << ": " << summary << " (" << elapsed << " ms)" << endl;
+    if (elapsed > REPLAY_LIMIT_MS)
+    {
+      cout << "Error: '" << argv[index] << "' took " << elapsed <<
+        " ms, which is over the limit of " << REPLAY_LIMIT_MS << " ms." << endl;
+      passed = false;
+    }
+    string expected;
+    if (check && !readFile(string(argv[index]) + REPLAY_EXPECTED, expected))
+    {
+      cout << "Error: Failed to read '" << argv[index] << REPLAY_EXPECTED <<
+        "'." << endl;
+      passed = false;
+      continue;
+    }
+    expected = expected.substr(0, expected.find_first_of("\r\n"));
+    if (check && (summary != expected))
+    {
+      cout << "Error: Expected '" << argv[index] << "' to give '" << expected <<
+        "'." << endl;
+      passed = false;
+    }
+  }
+  return passed ? 0 : -1;
+}
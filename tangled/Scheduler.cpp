@@ -0,0 +1,252 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#if defined(__linux__)
+  #include <sched.h>
+#endif
+using namespace std;
+#define NO_WORKER 0xFFFFFFFF
+
+static thread_local const Scheduler* currentScheduler = nullptr;
+static thread_local uint32_t currentWorker = NO_WORKER;
+
+Scheduler::Scheduler(uint32_t jobs) :
+  queuedCount(0),
+  stopping(false),
+  nextWorker(0),
+  startTime(chrono::steady_clock::now())
+{
+  jobs = max(jobs, 1u);
+  for (uint32_t index = 0; index < jobs; ++index)
+  {
+    unique_ptr<Worker> worker(new Worker());
+    worker->taskCount = 0;
+    worker->stolenCount = 0;
+    worker->busyNanoseconds = 0;
+    workers.push_back(move(worker));
+  }
+  for (uint32_t index = 0; index < jobs; ++index)
+  {
+    workers[index]->thread = thread(&Scheduler::run, this, index);
+  }
+}
+Scheduler::~Scheduler()
+{
+  {
+    lock_guard<mutex> lock(queueMutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto it = workers.begin(); it != workers.end(); ++it)
+  {
+    (*it)->thread.join();
+  }
+}
+
+void Scheduler::submit(function<void()> task)
+{
+  uint32_t index = (currentScheduler == this) ? currentWorker :
+    static_cast<uint32_t>(nextWorker++ % workers.size());
+  {
+    lock_guard<mutex> lock(workers[index]->tasksMutex);
+    workers[index]->tasks.push_back(move(task));
+  }
+  {
+    lock_guard<mutex> lock(queueMutex);
+    queuedCount += 1;
+  }
+  condition.notify_one();
+}
+void Scheduler::parallelFor(size_t count, const function<void(size_t)>& body)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  atomic<size_t> nextIndex(0);
+  size_t taskCount = min(count, workers.size());
+  size_t remaining = taskCount;
+  mutex doneMutex;
+  condition_variable done;
+  for (size_t task = 0; task < taskCount; ++task)
+  {
+    submit([&]()
+    {
+      size_t index;
+      while ((index = nextIndex++) < count)
+      {
+        body(index);
+      }
+      lock_guard<mutex> lock(doneMutex);
+      if (--remaining == 0)
+      {
+        done.notify_all();
+      }
+    });
+  }
+  unique_lock<mutex> lock(doneMutex);
+  done.wait(lock, [&]() { return remaining == 0; });
+}
+void Scheduler::run(uint32_t index)
+{
+  currentScheduler = this;
+  currentWorker = index;
+  Worker& worker = *workers[index];
+  while (true)
+  {
+    {
+      unique_lock<mutex> lock(queueMutex);
+      condition.wait(lock, [&]() { return stopping || (queuedCount > 0); });
+      if (queuedCount == 0)
+      {
+        return;
+      }
+      queuedCount -= 1;
+    }
+    function<void()> task;
+    bool stolen = false;
+    while (!takeTask(index, task, stolen))
+    {
+      this_thread::yield();
+    }
+    auto start = chrono::steady_clock::now();
+    task();
+    worker.busyNanoseconds += chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now() - start).count();
+    worker.taskCount += 1;
+    worker.stolenCount += stolen ? 1 : 0;
+  }
+}
+bool Scheduler::takeTask(uint32_t index, function<void()>& task, bool& stolen)
+{
+  {
+    Worker& own = *workers[index];
+    lock_guard<mutex> lock(own.tasksMutex);
+    if (!own.tasks.empty())
+    {
+      task = move(own.tasks.back());
+      own.tasks.pop_back();
+      stolen = false;
+      return true;
+    }
+  }
+  for (size_t offset = 1; offset < workers.size(); ++offset)
+  {
+    Worker& victim = *workers[(index + offset) % workers.size()];
+    lock_guard<mutex> lock(victim.tasksMutex);
+    if (!victim.tasks.empty())
+    {
+      task = move(victim.tasks.front());
+      victim.tasks.pop_front();
+      stolen = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t Scheduler::getJobs() const
+{
+  return static_cast<uint32_t>(workers.size());
+}
+void Scheduler::report(ostream& stream) const
+{
+  double elapsed = chrono::duration<double, milli>(
+    chrono::steady_clock::now() - startTime).count();
+  stream << setw(8) << "Worker" << setw(10) << "Tasks" << setw(10) <<
+    "Stolen" << setw(12) << "Busy (ms)" << setw(14) << "Utilization" << endl;
+  for (size_t index = 0; index < workers.size(); ++index)
+  {
+    const Worker& worker = *workers[index];
+    double busy = static_cast<double>(worker.busyNanoseconds) / 1000000.0;
+    stream << setw(8) << index << setw(10) << worker.taskCount <<
+      setw(10) << worker.stolenCount << setw(12) << fixed <<
+      setprecision(3) << busy << setw(13) << setprecision(1) <<
+      ((elapsed > 0) ? (100.0 * busy / elapsed) : 0.0) << "%" << endl;
+  }
+}
+uint32_t Scheduler::detectJobs()
+{
+  uint32_t jobs = max(thread::hardware_concurrency(), 1u);
+#if defined(__linux__)
+  cpu_set_t cpus;
+  if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+  {
+    jobs = max(CPU_COUNT(&cpus), 1);
+  }
+  string unifiedPath("/");
+  string cpuPath("/");
+  ifstream cgroups("/proc/self/cgroup");
+  string line;
+  while (getline(cgroups, line))
+  {
+    size_t first = line.find(':');
+    size_t second = (first != string::npos) ? line.find(':', first + 1) :
+      string::npos;
+    if (second == string::npos)
+    {
+      continue;
+    }
+    string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+    if ((line.compare(0, first, "0") == 0) && (controllers == ",,"))
+    {
+      unifiedPath = line.substr(second + 1);
+    }
+    else if (controllers.find(",cpu,") != string::npos)
+    {
+      cpuPath = line.substr(second + 1);
+    }
+  }
+  jobs = applyQuotas(jobs, "/sys/fs/cgroup", unifiedPath, true);
+  jobs = applyQuotas(jobs, "/sys/fs/cgroup/cpu", cpuPath, false);
+#endif
+  return jobs;
+}
+uint32_t Scheduler::applyQuotas(uint32_t jobs, const string& mount,
+  string path, bool unified)
+{
+#if defined(__linux__)
+  while (true)
+  {
+    string directory = mount + ((path == "/") ? string() : path) + "/";
+    int64_t quota = 0;
+    int64_t period = 0;
+    if (unified)
+    {
+      ifstream cpuMax(directory + "cpu.max");
+      string quotaText;
+      if ((cpuMax >> quotaText >> period) && (quotaText != "max"))
+      {
+        quota = strtoll(quotaText.c_str(), nullptr, 10);
+      }
+    }
+    else
+    {
+      ifstream quotaStream(directory + "cpu.cfs_quota_us");
+      ifstream periodStream(directory + "cpu.cfs_period_us");
+      if (!(quotaStream >> quota) || !(periodStream >> period))
+      {
+        quota = 0;
+      }
+    }
+    if ((quota > 0) && (period > 0))
+    {
+      jobs = min(jobs, static_cast<uint32_t>(max<int64_t>(
+        (quota + period - 1) / period, 1)));
+    }
+    size_t slash = path.rfind('/');
+    if ((slash == string::npos) || (path == "/"))
+    {
+      break;
+    }
+    path = path.substr(0, max<size_t>(slash, 1));
+  }
+#else
+  (void)mount;
+  (void)path;
+  (void)unified;
+#endif
+  return jobs;
+}
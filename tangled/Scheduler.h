@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Scheduler
+{
+public:
+  Scheduler(uint32_t jobs);
+  virtual ~Scheduler();
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+public:
+  void submit(std::function<void()> task);
+  void parallelFor(size_t count, const std::function<void(size_t)>& body);
+  uint32_t getJobs() const;
+  void report(std::ostream& stream) const;
+  static uint32_t detectJobs();
+
+private:
+  struct Worker
+  {
+    std::mutex tasksMutex;
+    std::deque<std::function<void()>> tasks;
+    std::atomic<uint64_t> taskCount;
+    std::atomic<uint64_t> stolenCount;
+    std::atomic<uint64_t> busyNanoseconds;
+    std::thread thread;
+  };
+
+  void run(uint32_t index);
+  bool takeTask(uint32_t index, std::function<void()>& task, bool& stolen);
+  static uint32_t applyQuotas(uint32_t jobs, const std::string& mount,
+    std::string path, bool unified);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::mutex queueMutex;
+  std::condition_variable condition;
+  size_t queuedCount;
+  bool stopping;
+  std::atomic<uint32_t> nextWorker;
+  std::chrono::steady_clock::time_point startTime;
+};
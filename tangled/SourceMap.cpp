@@ -0,0 +1,170 @@
+#include "SourceMap.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+using namespace std;
+#define SOURCE_MAP_MAGIC "LITMAP01"
+
+SourceMap::SourceMap()
+{
+}
+
+SourceMap::SourceMap(const vector<string>& sourcePaths,
+  const vector<LineOrigin>& origins)
+{
+  unordered_map<uint32_t, uint32_t> indices;
+  for (uint32_t index = 0; index < origins.size(); ++index)
+  {
+    const LineOrigin& origin = origins[index];
+    if (origin.source >= sourcePaths.size())
+    {
+      continue;
+    }
+    auto sourceIt = indices.find(origin.source);
+    if (sourceIt == indices.end())
+    {
+      sourceIt = indices.insert(make_pair(origin.source,
+        static_cast<uint32_t>(sources.size()))).first;
+      sources.push_back(sourcePaths[origin.source]);
+    }
+    uint32_t outputLine = index + 1;
+    uint32_t sourceLine = origin.line + 1;
+    if (!runs.empty() && (runs.back().source == sourceIt->second) &&
+      (runs.back().outputLine + runs.back().count == outputLine) &&
+      (runs.back().sourceLine + runs.back().count == sourceLine))
+    {
+      runs.back().count += 1;
+    }
+    else
+    {
+      runs.push_back(Run{outputLine, sourceIt->second, sourceLine, 1});
+    }
+  }
+}
+
+bool SourceMap::write(string path)
+{
+  string data = serialize();
+  ifstream inStream(path, ios::binary);
+  if (inStream.good())
+  {
+    stringstream existing;
+    existing << inStream.rdbuf();
+    if (existing.str() == data)
+    {
+      return true;
+    }
+  }
+  inStream.close();
+  ofstream outStream(path, ios::binary);
+  outStream.write(data.data(), data.size());
+  outStream.close();
+  if (!outStream.good())
+  {
+    cout << "Error: Failed to write source map '" << path << "'." << endl;
+    return false;
+  }
+  return true;
+}
+bool SourceMap::read(string path)
+{
+  ifstream stream(path, ios::binary);
+  stringstream contents;
+  contents << stream.rdbuf();
+  string data = contents.str();
+  size_t offset = strlen(SOURCE_MAP_MAGIC);
+  uint32_t count;
+  bool valid = (data.compare(0, offset, SOURCE_MAP_MAGIC) == 0) &&
+    readNumber(data, offset, count);
+  for (uint32_t index = 0; valid && (index < count); ++index)
+  {
+    uint32_t length;
+    valid = readNumber(data, offset, length) &&
+      (offset + length <= data.size());
+    if (valid)
+    {
+      sources.push_back(data.substr(offset, length));
+      offset += length;
+    }
+  }
+  valid = valid && readNumber(data, offset, count);
+  for (uint32_t index = 0; valid && (index < count); ++index)
+  {
+    Run run;
+    valid = readNumber(data, offset, run.outputLine) &&
+      readNumber(data, offset, run.source) &&
+      readNumber(data, offset, run.sourceLine) &&
+      readNumber(data, offset, run.count) && (run.source < sources.size());
+    runs.push_back(run);
+  }
+  if (!valid)
+  {
+    cout << "Error: Failed to read source map '" << path << "'." << endl;
+  }
+  return valid;
+}
+bool SourceMap::locate(uint32_t outputLine, string& sourceFile,
+  uint32_t& sourceLine)
+{
+  auto it = upper_bound(runs.begin(), runs.end(), outputLine,
+    [](uint32_t line, const Run& run) { return line < run.outputLine; });
+  if (it == runs.begin())
+  {
+    return false;
+  }
+  --it;
+  if (outputLine >= it->outputLine + it->count)
+  {
+    return false;
+  }
+  sourceFile = sources[it->source];
+  sourceLine = it->sourceLine + (outputLine - it->outputLine);
+  return true;
+}
+
+string SourceMap::serialize()
+{
+  string data = SOURCE_MAP_MAGIC;
+  writeNumber(data, static_cast<uint32_t>(sources.size()));
+  for (auto it = sources.begin(); it != sources.end(); ++it)
+  {
+    writeNumber(data, static_cast<uint32_t>(it->size()));
+    data += *it;
+  }
+  writeNumber(data, static_cast<uint32_t>(runs.size()));
+  for (auto it = runs.begin(); it != runs.end(); ++it)
+  {
+    writeNumber(data, it->outputLine);
+    writeNumber(data, it->source);
+    writeNumber(data, it->sourceLine);
+    writeNumber(data, it->count);
+  }
+  return data;
+}
+void SourceMap::writeNumber(string& data, uint32_t value)
+{
+  for (int index = 0; index < 4; ++index)
+  {
+    data += static_cast<char>((value >> (8 * index)) & 0xFF);
+  }
+}
+
+bool SourceMap::readNumber(const string& data, size_t& offset,
+  uint32_t& value)
+{
+  if (offset + 4 > data.size())
+  {
+    return false;
+  }
+  value = 0;
+  for (int index = 0; index < 4; ++index)
+  {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(
+      data[offset + index])) << (8 * index);
+  }
+  offset += 4;
+  return true;
+}
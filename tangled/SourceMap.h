@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Block.h"
+
+#define SOURCE_MAP_EXTENSION ".litmap"
+
+class SourceMap
+{
+public:
+  SourceMap();
+  SourceMap(const std::vector<std::string>& sourcePaths,
+    const std::vector<LineOrigin>& origins);
+
+public:
+  bool write(std::string path);
+  bool read(std::string path);
+  bool locate(uint32_t outputLine, std::string& sourceFile,
+    uint32_t& sourceLine);
+  std::string serialize();
+
+private:
+  struct Run
+  {
+    uint32_t outputLine;
+    uint32_t source;
+    uint32_t sourceLine;
+    uint32_t count;
+  };
+
+  static void writeNumber(std::string& data, uint32_t value);
+  static bool readNumber(const std::string& data, size_t& offset,
+    uint32_t& value);
+
+  std::vector<std::string> sources;
+  std::vector<Run> runs;
+};
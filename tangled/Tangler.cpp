@@ -1,7 +1,10 @@
 #include "Tangler.h"
+#include <cerrno>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include "Archive.h"
+#include "SourceMap.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 #if defined(__linux__) || defined(__APPLE__)
@@ -9,45 +12,292 @@
 #elif _WIN32
   #include "Windows.h"
 #endif
-#include <regex>
+#include <unordered_set>
+#include <algorithm>
 using namespace std;
+#define C_EXTENSIONS " .c .cc .cpp .cxx .h .hh .hpp .hxx "
+#define NO_SOURCE 0xFFFFFFFF
+#define RESERVE_MAX_LINES (1 << 20)
 
-bool Tangler::tangle(map<string, FileBlock*> fileBlocks,
-    map<string, CodeBlock*> codeBlocks, string outputDirectory)
+void Tangler::setProvenance(const vector<Source>& sources,
+  const vector<string>& importedPaths, bool maps, bool directives)
 {
-  for (auto it = codeBlocks.begin(); it != codeBlocks.end(); ++it)
+  sourcePaths.resize(sourceCount);
+  for (size_t index = sourceCount; index < sources.size(); ++index)
   {
-    vector<string> output;
-    if (!tangleBlock(it->second, codeBlocks, output))
+    sourcePaths.push_back(sources[index].path);
+  }
+  sourceCount = sources.size();
+  sourcePaths.insert(sourcePaths.end(), importedPaths.begin(),
+    importedPaths.end());
+  sourceMaps = maps;
+  lineDirectives = directives;
+}
+void Tangler::setProfiler(Profiler* newProfiler)
+{
+  profiler = newProfiler;
+}
+void Tangler::setCache(OutputCache* newCache)
+{
+  cache = newCache;
+}
+void Tangler::setEstimator(const Estimator* newEstimator)
+{
+  estimator = newEstimator;
+}
+void Tangler::setScheduler(Scheduler* newScheduler)
+{
+  scheduler = newScheduler;
+}
+
+bool Tangler::tangle(const BlockStore& blocks, string outputDirectory,
+    Manifest* manifest)
+{
+  if ((cache != nullptr) && !sourceMaps)
+  {
+    return tangleCached(blocks, outputDirectory, manifest);
+  }
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  vector<TangledBlock> outputFiles;
+  if (!tangleFiles(blocks, outputFiles))
+  {
+    return false;
+  }
+  if (outputDirectory.back() != '/')
+  {
+    outputDirectory += "/";
+  }
+  vector<uint8_t> written(outputFiles.size(), 0);
+  forEach(outputFiles.size(), [&](size_t index)
+  {
+    written[index] = writeFile(fileBlocks[index], outputFiles[index],
+      outputDirectory, manifest);
+  });
+  if (find(written.begin(), written.end(), 0) != written.end())
+  {
+    return false;
+  }
+  return true;
+}
+bool Tangler::tangleToStream(const BlockStore& blocks, string fileName,
+    ostream& stream)
+{
+  uint32_t fileIndex;
+  if (!blocks.findFileBlock(fileName, fileIndex))
+  {
+    cout << "Error: Unable to find file block '" << fileName << "'." << endl;
+    return false;
+  }
+  LineGenerator generator(blocks, &blocks.getFileBlocks()[fileIndex]);
+  generateLines(generator, hasLineDirectives(fileName),
+    [&](const string& line)
+    {
+      stream << line << '\n';
+      return stream.good();
+    });
+  if (!generator.getError().empty())
+  {
+    cout << "Error: " << generator.getError() << endl;
+    return false;
+  }
+  stream.flush();
+  return stream.good();
+}
+bool Tangler::tangleToArchive(const BlockStore& blocks, ostream& stream)
+{
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  vector<TangledBlock> outputFiles;
+  if (!tangleFiles(blocks, outputFiles))
+  {
+    return false;
+  }
+  Archive archive(stream);
+  for (uint32_t index = 0; index < outputFiles.size(); ++index)
+  {
+    const FileBlock& fileBlock = fileBlocks[index];
+    TangledBlock& output = outputFiles[index];
+    addLineDirectives(fileBlock.getName(), output);
+    stringstream concatStream;
+    for (auto it = output.lines.begin(); it != output.lines.end(); ++it)
+    {
+      concatStream << *it << endl;
+    }
+    string outputString = concatStream.str();
+    if (!archive.addFile(fileBlock.getName(), outputString,
+      fileBlock.getExecutable()))
     {
       return false;
     }
-    tangledBlocks.insert(make_pair(it->first, output));
   }
-  map<FileBlock*, vector<string>> outputFiles;
-  for (auto it = fileBlocks.begin(); it != fileBlocks.end(); ++it)
+  return archive.close();
+}
+bool Tangler::preview(const BlockStore& blocks, string name,
+  uint32_t lineCount, ostream& stream)
+{
+  uint32_t index;
+  const Block* block = nullptr;
+  if (blocks.findFileBlock(name, index))
+  {
+    block = &blocks.getFileBlocks()[index];
+  }
+  else if (blocks.findCodeBlock(name, index))
   {
-    vector<string> output;
-    if (!tangleBlock(it->second, codeBlocks, output))
+    block = &blocks.getCodeBlocks()[index];
+  }
+  else
+  {
+    cout << "Error: Unable to find block '" << name << "'." << endl;
+    return false;
+  }
+  LineGenerator generator(blocks, block);
+  string line;
+  LineOrigin origin;
+  for (uint32_t count = 0; (count < lineCount) &&
+    generator.next(line, origin); ++count)
+  {
+    stream << line << '\n';
+  }
+  if (!generator.getError().empty())
+  {
+    cout << "Error: " << generator.getError() << endl;
+    return false;
+  }
+  stream.flush();
+  return stream.good();
+}
+bool Tangler::generateLines(LineGenerator& generator, bool directives,
+  const function<bool(const string&)>& consume)
+{
+  string line, previousLine;
+  LineOrigin origin, previousOrigin;
+  bool first = true;
+  while (generator.next(line, origin))
+  {
+    if (directives && needsLineDirective(first ? nullptr : &previousLine,
+      first ? nullptr : &previousOrigin, origin) &&
+      !consume(lineDirective(origin)))
+    {
+      return false;
+    }
+    if (!consume(line))
     {
       return false;
     }
-    outputFiles.insert(make_pair(it->second, output));
+    previousLine = move(line);
+    previousOrigin = origin;
+    first = false;
   }
-  if (outputDirectory.back() != '/')
+  return true;
+}
+
+bool Tangler::tangleFiles(const BlockStore& blocks,
+    vector<TangledBlock>& outputFiles)
+{
+  tangledBlocks.assign(blocks.getCodeBlocks().size(), TangledBlock());
+  isTangled.assign(blocks.getCodeBlocks().size(), false);
+  isExpanding.assign(blocks.getCodeBlocks().size(), false);
+  if (canExpandInParallel())
   {
-    outputDirectory += "/";
+    if (!tangleWaves(blocks, nullptr))
+    {
+      return false;
+    }
+    const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+    size_t codeCount = blocks.getCodeBlocks().size();
+    outputFiles.assign(fileBlocks.size(), TangledBlock());
+    vector<uint8_t> tangled(fileBlocks.size(), 0);
+    forEach(fileBlocks.size(), [&](size_t index)
+    {
+      reserveLines(static_cast<uint32_t>(codeCount + index), outputFiles[index]);
+      tangled[index] = tangleBlock(&fileBlocks[index], blocks, outputFiles[index]);
+    });
+    if (find(tangled.begin(), tangled.end(), 0) != tangled.end())
+    {
+      return false;
+    }
+    return true;
   }
-  for (auto it = outputFiles.begin(); it != outputFiles.end(); ++it)
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  for (uint32_t index = 0; index < codeBlocks.size(); ++index)
   {
-    string outputPath = outputDirectory + it->first->getName();
-    stringstream concatStream;
-    vector<string> outputLines = it->second;
-    for (auto it = outputLines.begin(); it != outputLines.end(); ++it)
+    if (isTangled[index])
     {
-      concatStream << *it << endl;
+      continue;
     }
-    string outputString = concatStream.str();
+    chrono::steady_clock::time_point start;
+    if (profiler != nullptr)
+    {
+      start = chrono::steady_clock::now();
+    }
+    reserveLines(index, tangledBlocks[index]);
+    if (!tangleBlock(&codeBlocks[index], blocks, tangledBlocks[index]))
+    {
+      return false;
+    }
+    isTangled[index] = true;
+    if (profiler != nullptr)
+    {
+      profiler->addTime(index, chrono::steady_clock::now() - start);
+    }
+  }
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  outputFiles.assign(fileBlocks.size(), TangledBlock());
+  for (uint32_t index = 0; index < fileBlocks.size(); ++index)
+  {
+    reserveLines(static_cast<uint32_t>(codeBlocks.size()) + index,
+      outputFiles[index]);
+    if (!tangleBlock(&fileBlocks[index], blocks, outputFiles[index]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+bool Tangler::writeFile(const FileBlock& fileBlock, TangledBlock& output,
+  const string& outputDirectory, Manifest* manifest)
+{
+  string outputPath = outputDirectory + fileBlock.getName();
+  addLineDirectives(fileBlock.getName(), output);
+  stringstream concatStream;
+  for (auto it = output.lines.begin(); it != output.lines.end(); ++it)
+  {
+    concatStream << *it << endl;
+  }
+  string outputString = concatStream.str();
+  if (!writeOutput(fileBlock, outputString, "", outputPath, manifest))
+  {
+    return false;
+  }
+  if (sourceMaps)
+  {
+    string mapPath = outputPath + SOURCE_MAP_EXTENSION;
+    SourceMap sourceMap(sourcePaths, output.origins);
+    if (!sourceMap.write(mapPath))
+    {
+      return false;
+    }
+    if (manifest != nullptr)
+    {
+      uint64_t mapHash = Manifest::hash(sourceMap.serialize());
+      lock_guard<mutex> lock(manifestMutex);
+      manifest->addOutput(mapPath, mapHash);
+    }
+  }
+  return true;
+}
+bool Tangler::writeOutput(const FileBlock& fileBlock, const string& outputString,
+  const string& cachedPath, const string& outputPath, Manifest* manifest)
+{
+  uint64_t outputHash = (manifest != nullptr) ? Manifest::hash(outputString) : 0;
+  bool unchanged = false;
+  if (manifest != nullptr)
+  {
+    lock_guard<mutex> lock(manifestMutex);
+    unchanged = manifest->checkOutput(outputPath, outputHash);
+  }
+  bool recorded = unchanged;
+  if (!unchanged)
+  {
     ifstream inStream(outputPath);
     if (inStream.good())
     {
@@ -56,9 +306,12 @@ bool Tangler::tangle(map<string, FileBlock*> fileBlocks,
       inStream.close();
       if (existingFile.str() == outputString)
       {
-        continue;
+        unchanged = true;
       }
     }
+  }
+  if (!unchanged)
+  {
     size_t position = outputPath.find("/", 0);
     while (position != string::npos)
     {
@@ -66,11 +319,12 @@ bool Tangler::tangle(map<string, FileBlock*> fileBlocks,
       struct stat st;
       if (stat(directory.c_str(), &st) != 0)
       {
-    #if defined(__linux__) || defined(__APPLE__)        
-        if (mkdir(directory.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
-          S_IROTH | S_IXOTH) != 0)
+    #if defined(__linux__) || defined(__APPLE__)
+        if ((mkdir(directory.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
+          S_IROTH | S_IXOTH) != 0) && (errno != EEXIST))
     #elif _WIN32
-        if (!CreateDirectoryA(directory.c_str(), NULL))
+        if (!CreateDirectoryA(directory.c_str(), NULL) &&
+          (GetLastError() != ERROR_ALREADY_EXISTS))
     #endif
         {
           cout << "Error: Failed to create directory '" << directory <<
@@ -86,80 +340,578 @@ bool Tangler::tangle(map<string, FileBlock*> fileBlocks,
       }
       position = outputPath.find("/", position + 1);
     }
-    ofstream outStream(outputPath);
-    outStream << outputString;
-    outStream.close();
-    #if defined(__linux__) || defined(__APPLE__)
-    if (it->first->getExecutable())
+    if (cachedPath.empty() ||
+      !OutputCache::clone(cachedPath, outputPath, outputString.size()))
     {
-      struct stat st;
-      if (stat(outputPath.c_str(), &st) != 0)
+      ofstream outStream(outputPath);
+      outStream << outputString;
+      outStream.close();
+    }
+  }
+  #if defined(__linux__) || defined(__APPLE__)
+  if (fileBlock.getExecutable())
+  {
+    struct stat st;
+    if (stat(outputPath.c_str(), &st) != 0)
+    {
+      cout << "Error: Failed to check file permissions for '" << outputPath <<
+        "'." << endl;
+      return false;
+    }
+    mode_t mode = st.st_mode | S_IXUSR | S_IXGRP | S_IXOTH;
+    if ((mode != st.st_mode) && (chmod(outputPath.c_str(), mode) != 0))
+    {
+      cout << "Error: Failed to set execute bit on '" << outputPath <<
+        "'." << endl;
+      return false;
+    }
+  }
+  #endif
+  if (!recorded)
+  {
+    if (manifest != nullptr)
+    {
+      lock_guard<mutex> lock(manifestMutex);
+      manifest->addOutput(outputPath, outputHash);
+    }
+  }
+  return true;
+}
+
+bool Tangler::tangleCached(const BlockStore& blocks, string outputDirectory,
+  Manifest* manifest)
+{
+  tangledBlocks.assign(blocks.getCodeBlocks().size(), TangledBlock());
+  isTangled.assign(blocks.getCodeBlocks().size(), false);
+  isExpanding.assign(blocks.getCodeBlocks().size(), false);
+  cache->reset(blocks.getCodeBlocks().size());
+  if (outputDirectory.back() != '/')
+  {
+    outputDirectory += "/";
+  }
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  vector<string> keys(fileBlocks.size());
+  vector<uint8_t> isFirstKey(fileBlocks.size(), 0);
+  unordered_set<string> seenKeys;
+  for (uint32_t index = 0; index < fileBlocks.size(); ++index)
+  {
+    if (!cache->makeKey(blocks, fileBlocks[index],
+      hasLineDirectives(fileBlocks[index].getName()), sourcePaths, keys[index]))
+    {
+      return false;
+    }
+    isFirstKey[index] = seenKeys.insert(keys[index]).second;
+  }
+  vector<string> outputStrings(fileBlocks.size());
+  vector<string> cachedPaths(fileBlocks.size());
+  vector<uint8_t> missed(fileBlocks.size(), 0);
+  forEach(fileBlocks.size(), [&](size_t index)
+  {
+    if (cache->fetch(keys[index], outputStrings[index]))
+    {
+      cachedPaths[index] = cache->getEntryPath(keys[index]);
+    }
+    else
+    {
+      missed[index] = 1;
+    }
+  });
+  vector<uint8_t> expanded(fileBlocks.size(), 1);
+  auto expand = [&](size_t index)
+  {
+    if (missed[index])
+    {
+      expanded[index] = expandFile(fileBlocks[index], blocks,
+        outputStrings[index]);
+    }
+  };
+  if (canExpandInParallel())
+  {
+    vector<uint8_t> needed(blocks.getCodeBlocks().size(), 0);
+    vector<uint32_t> nodes;
+    for (uint32_t index = 0; index < fileBlocks.size(); ++index)
+    {
+      if (missed[index])
       {
-        cout << "Error: Failed to check file permissions for '" << outputPath <<
-          "'." << endl;
-        return false;
+        nodes.push_back(static_cast<uint32_t>(needed.size()) + index);
       }
-      if (chmod(outputPath.c_str(), st.st_mode | S_IXUSR | S_IXGRP |
-        S_IXOTH) != 0)
+    }
+    while (!nodes.empty())
+    {
+      const vector<Estimator::Reference>& references =
+        estimator->getReferences(nodes.back());
+      nodes.pop_back();
+      for (auto it = references.begin(); it != references.end(); ++it)
       {
-        cout << "Error: Failed to set execute bit on '" << outputPath <<
-          "'." << endl;
-        return false;
+        if (!needed[it->child])
+        {
+          needed[it->child] = 1;
+          nodes.push_back(it->child);
+        }
       }
     }
-    #endif
+    if (!tangleWaves(blocks, &needed))
+    {
+      return false;
+    }
+    forEach(fileBlocks.size(), expand);
+  }
+  else
+  {
+    for (uint32_t index = 0; index < fileBlocks.size(); ++index)
+    {
+      expand(index);
+    }
+  }
+  if (find(expanded.begin(), expanded.end(), 0) != expanded.end())
+  {
+    return false;
+  }
+  vector<uint8_t> written(fileBlocks.size(), 0);
+  forEach(fileBlocks.size(), [&](size_t index)
+  {
+    if (missed[index] && isFirstKey[index])
+    {
+      cache->store(keys[index], outputStrings[index]);
+    }
+    written[index] = writeOutput(fileBlocks[index], outputStrings[index],
+      cachedPaths[index], outputDirectory + fileBlocks[index].getName(),
+      manifest);
+  });
+  if (find(written.begin(), written.end(), 0) != written.end())
+  {
+    return false;
   }
   return true;
 }
+bool Tangler::expandFile(const FileBlock& fileBlock, const BlockStore& blocks,
+  string& result)
+{
+  TangledBlock output;
+  if (!tangleBlock(&fileBlock, blocks, output))
+  {
+    return false;
+  }
+  addLineDirectives(fileBlock.getName(), output);
+  stringstream concatStream;
+  for (auto it = output.lines.begin(); it != output.lines.end(); ++it)
+  {
+    concatStream << *it << endl;
+  }
+  string outputString = concatStream.str();
+  result = move(outputString);
+  return true;
+}
 
-bool Tangler::tangleBlock(Block* block, map<string, CodeBlock*> codeBlocks,
-  vector<string>& output)
+bool Tangler::tangleReady(const BlockStore& blocks,
+  const function<bool(const string&)>& isFinal,
+  const vector<string>* settledNames, string outputDirectory,
+  Manifest* manifest)
 {
-  regex regEx("^(\\s*)@\\{((\\[|\\]|\\w|\\s).*)\\}\\s*$");
-  vector<string> lines = block->getLines();
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  tangledBlocks.resize(blocks.getCodeBlocks().size());
+  isTangled.resize(blocks.getCodeBlocks().size(), false);
+  isExpanding.resize(blocks.getCodeBlocks().size(), false);
+  isClosureKnown.resize(blocks.getCodeBlocks().size(), false);
+  if (outputDirectory.back() != '/')
+  {
+    outputDirectory += "/";
+  }
+  vector<uint32_t> checks;
+  for (uint32_t index = readyCheckedCount; index < fileBlocks.size(); ++index)
+  {
+    checks.push_back(index);
+  }
+  readyCheckedCount = static_cast<uint32_t>(fileBlocks.size());
+  if (settledNames == nullptr)
+  {
+    for (auto it = waitingFiles.begin(); it != waitingFiles.end(); ++it)
+    {
+      checks.insert(checks.end(), it->second.begin(), it->second.end());
+    }
+    waitingFiles.clear();
+  }
+  else
+  {
+    for (auto it = settledNames->begin(); it != settledNames->end(); ++it)
+    {
+      auto waiting = waitingFiles.find(*it);
+      if (waiting != waitingFiles.end())
+      {
+        checks.insert(checks.end(), waiting->second.begin(),
+          waiting->second.end());
+        waitingFiles.erase(waiting);
+      }
+    }
+  }
+  sort(checks.begin(), checks.end());
+  vector<uint32_t> ready;
+  for (auto it = checks.begin(); it != checks.end(); ++it)
+  {
+    string missing;
+    if (!isClosureFinal(&fileBlocks[*it], blocks, isFinal, &missing))
+    {
+      waitingFiles[missing].push_back(*it);
+      continue;
+    }
+    ready.push_back(*it);
+  }
+  vector<TangledBlock> outputs(ready.size());
+  for (size_t index = 0; index < ready.size(); ++index)
+  {
+    if (!tangleBlock(&fileBlocks[ready[index]], blocks, outputs[index]))
+    {
+      return false;
+    }
+  }
+  vector<uint8_t> written(ready.size(), 0);
+  forEach(ready.size(), [&](size_t index)
+  {
+    written[index] = writeFile(fileBlocks[ready[index]], outputs[index],
+      outputDirectory, manifest);
+  });
+  if (find(written.begin(), written.end(), 0) != written.end())
+  {
+    return false;
+  }
+  return true;
+}
+bool Tangler::isClosureFinal(const Block* block, const BlockStore& blocks,
+  const function<bool(const string&)>& isFinal, string* missing)
+{
+  const vector<string>& lines = block->getLines();
   for (auto it = lines.begin(); it != lines.end(); ++it)
   {
-    string line = *it;
-    smatch results;
-    if (!regex_match(line, results, regEx))
+    string whitespace, name;
+    uint32_t index;
+    if (!Block::parseReference(*it, whitespace, name))
     {
-      output.push_back(line);
       continue;
     }
-    if (results.size() != 4)
+    if (!isFinal(name))
     {
-      cout << "Error: Unexpected results parsing line '" << line <<
-        "'." << endl;
+      if (missing != nullptr)
+      {
+        *missing = name;
+      }
+      return false;
+    }
+    if (!blocks.findCodeBlock(name, index) || isClosureKnown[index])
+    {
+      continue;
+    }
+    isClosureKnown[index] = true;
+    if (!isClosureFinal(&blocks.getCodeBlocks()[index], blocks, isFinal,
+      missing))
+    {
+      isClosureKnown[index] = false;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Tangler::verify(const BlockStore& blocks, string outputDirectory)
+{
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  if (outputDirectory.back() != '/')
+  {
+    outputDirectory += "/";
+  }
+  enum Result { Current, Stale, Missing, Failed };
+  vector<Result> results(fileBlocks.size(), Current);
+  vector<string> errors(fileBlocks.size());
+  vector<uint32_t> schedule;
+  for (uint32_t index = 0; index < fileBlocks.size(); ++index)
+  {
+    schedule.push_back(index);
+  }
+  if (estimator != nullptr)
+  {
+    uint32_t codeCount = static_cast<uint32_t>(blocks.getCodeBlocks().size());
+    stable_sort(schedule.begin(), schedule.end(),
+      [&](uint32_t left, uint32_t right)
+      {
+        return estimator->getBytes(codeCount + left) >
+          estimator->getBytes(codeCount + right);
+      });
+  }
+  forEach(schedule.size(), [&](size_t next)
+  {
+    uint32_t index = schedule[next];
+    const FileBlock& fileBlock = fileBlocks[index];
+    string outputPath = outputDirectory + fileBlock.getName();
+    struct stat st;
+    if (stat(outputPath.c_str(), &st) != 0)
+    {
+      results[index] = Missing;
+      return;
+    }
+    ifstream stream(outputPath);
+    LineGenerator generator(blocks, &fileBlock);
+    string existing;
+    bool same = generateLines(generator, hasLineDirectives(fileBlock.getName()),
+      [&](const string& line)
+      {
+        existing.resize(line.size() + 1);
+        return stream.read(&existing[0], existing.size()) &&
+          (existing.compare(0, line.size(), line) == 0) &&
+          (existing.back() == '\n');
+      });
+    if (!generator.getError().empty())
+    {
+      results[index] = Failed;
+      errors[index] = generator.getError();
+    }
+    else if (!same || (stream.peek() != ifstream::traits_type::eof()))
+    {
+      results[index] = Stale;
+    }
+  #if defined(__linux__) || defined(__APPLE__)
+    if ((results[index] == Current) && fileBlock.getExecutable() &&
+      !(st.st_mode & S_IXUSR))
+    {
+      results[index] = Stale;
+    }
+  #endif
+  });
+  uint32_t staleCount = 0;
+  for (uint32_t index = 0; index < results.size(); ++index)
+  {
+    if (results[index] == Failed)
+    {
+      cout << "Error: " << errors[index] << endl;
       return false;
     }
-    string whitespace = results[1];
-    string name = results[2];
-    vector<string> childOutput;
-    bool found = false;
-    auto tangledBlock = tangledBlocks.find(name);
-    if (tangledBlock != tangledBlocks.end())
+    if (results[index] == Missing)
     {
-      childOutput = tangledBlock->second;
-      found = true;
+      cout << "Error: Output '" << outputDirectory <<
+        fileBlocks[index].getName() << "' is missing." << endl;
+      staleCount += 1;
     }
-    if (!found)
+    else if (results[index] == Stale)
     {
-      auto rawBlock = codeBlocks.find(name);
-      if (rawBlock == codeBlocks.end())
+      cout << "Error: Output '" << outputDirectory <<
+        fileBlocks[index].getName() << "' is out of date." << endl;
+      staleCount += 1;
+    }
+  }
+  cout << "Verify complete: " << staleCount << " of " << results.size() <<
+    " output(s) out of date." << endl;
+  return (staleCount == 0);
+}
+
+bool Tangler::expandCodeBlocks(const BlockStore& blocks,
+  vector<const TangledBlock*>& expanded)
+{
+  tangledBlocks.assign(blocks.getCodeBlocks().size(), TangledBlock());
+  isTangled.assign(blocks.getCodeBlocks().size(), false);
+  isExpanding.assign(blocks.getCodeBlocks().size(), false);
+  isClosureKnown.assign(blocks.getCodeBlocks().size(), false);
+  expanded.assign(blocks.getCodeBlocks().size(), nullptr);
+  auto isDefined = [&](const string& name)
+  {
+    uint32_t index;
+    return blocks.findCodeBlock(name, index);
+  };
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  for (uint32_t index = 0; index < codeBlocks.size(); ++index)
+  {
+    if (!isClosureFinal(&codeBlocks[index], blocks, isDefined))
+    {
+      continue;
+    }
+    if (!isTangled[index])
+    {
+      if (!tangleBlock(&codeBlocks[index], blocks, tangledBlocks[index]))
+      {
+        return false;
+      }
+      isTangled[index] = true;
+    }
+    expanded[index] = &tangledBlocks[index];
+  }
+  return true;
+}
+
+bool Tangler::tangleBlock(const Block* block, const BlockStore& blocks,
+  TangledBlock& output)
+{
+  const vector<string>& lines = block->getLines();
+  const vector<LineOrigin>& origins = block->getOrigins();
+  for (size_t index = 0; index < lines.size(); ++index)
+  {
+    const string& line = lines[index];
+    string whitespace, name;
+    if (!Block::parseReference(line, whitespace, name))
+    {
+      output.lines.push_back(line);
+      output.origins.push_back(origins[index]);
+      continue;
+    }
+    uint32_t childIndex;
+    if (!blocks.findCodeBlock(name, childIndex))
+    {
+      cout << "Error: Unable to find block '" << name << "'." << endl;
+      return false;
+    }
+    TangledBlock& childOutput = tangledBlocks[childIndex];
+    chrono::steady_clock::time_point start;
+    if (profiler != nullptr)
+    {
+      start = chrono::steady_clock::now();
+    }
+    if (!isTangled[childIndex])
+    {
+      if (isExpanding[childIndex])
       {
-        cout << "Error: Unable to find block '" << name << "'." << endl;
+        cout << "Error: Reference cycle through block '" << name << "'." << endl;
         return false;
       }
-      if (!tangleBlock(rawBlock->second, codeBlocks, childOutput))
+      isExpanding[childIndex] = true;
+      reserveLines(childIndex, childOutput);
+      if (!tangleBlock(&blocks.getCodeBlocks()[childIndex], blocks, childOutput))
       {
         return false;
       }
-      tangledBlocks.insert(make_pair(rawBlock->first, childOutput));
+      isExpanding[childIndex] = false;
+      isTangled[childIndex] = true;
+    }
+    for (size_t childLine = 0; childLine < childOutput.lines.size(); ++childLine)
+    {
+      output.lines.push_back(whitespace + childOutput.lines[childLine]);
+      output.origins.push_back(childOutput.origins[childLine]);
     }
-    for (auto it = childOutput.begin(); it != childOutput.end(); ++it)
+    if (profiler != nullptr)
     {
-      output.push_back(whitespace + *it);
+      profiler->addTime(childIndex, chrono::steady_clock::now() - start);
     }
   }
   return true;
 }
+void Tangler::reserveLines(uint32_t node, TangledBlock& output) const
+{
+  if ((estimator == nullptr) || (node >= estimator->getNodeCount()))
+  {
+    return;
+  }
+  uint64_t lines = min(estimator->getLines(node),
+    static_cast<uint64_t>(RESERVE_MAX_LINES));
+  output.lines.reserve(static_cast<size_t>(lines));
+  output.origins.reserve(static_cast<size_t>(lines));
+}
+bool Tangler::canExpandInParallel() const
+{
+  return (scheduler != nullptr) && (scheduler->getJobs() > 1) &&
+    (profiler == nullptr) && (estimator != nullptr) &&
+    estimator->isComplete();
+}
+bool Tangler::tangleWaves(const BlockStore& blocks,
+  const vector<uint8_t>* needed)
+{
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  vector<uint32_t> levels(codeBlocks.size(), 0);
+  vector<vector<uint32_t>> waves;
+  const vector<uint32_t>& order = estimator->getOrder();
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    if ((*it >= codeBlocks.size()) ||
+      ((needed != nullptr) && !(*needed)[*it]))
+    {
+      continue;
+    }
+    const vector<Estimator::Reference>& references =
+      estimator->getReferences(*it);
+    for (auto refIt = references.begin(); refIt != references.end(); ++refIt)
+    {
+      levels[*it] = max(levels[*it], levels[refIt->child] + 1);
+    }
+    if (levels[*it] >= waves.size())
+    {
+      waves.resize(levels[*it] + 1);
+    }
+    waves[levels[*it]].push_back(*it);
+  }
+  for (auto waveIt = waves.begin(); waveIt != waves.end(); ++waveIt)
+  {
+    const vector<uint32_t>& wave = *waveIt;
+    vector<uint8_t> tangled(wave.size(), 0);
+    forEach(wave.size(), [&](size_t index)
+    {
+      reserveLines(wave[index], tangledBlocks[wave[index]]);
+      tangled[index] = tangleBlock(&codeBlocks[wave[index]], blocks,
+        tangledBlocks[wave[index]]);
+    });
+    if (find(tangled.begin(), tangled.end(), 0) != tangled.end())
+    {
+      return false;
+    }
+    for (auto it = wave.begin(); it != wave.end(); ++it)
+    {
+      isTangled[*it] = true;
+    }
+  }
+  return true;
+}
+void Tangler::forEach(size_t count, const function<void(size_t)>& body)
+{
+  if ((scheduler == nullptr) || (count < 2))
+  {
+    for (size_t index = 0; index < count; ++index)
+    {
+      body(index);
+    }
+    return;
+  }
+  scheduler->parallelFor(count, body);
+}
+
+void Tangler::addLineDirectives(string fileName, TangledBlock& output)
+{
+  if (!hasLineDirectives(fileName))
+  {
+    return;
+  }
+  TangledBlock result;
+  for (size_t index = 0; index < output.lines.size(); ++index)
+  {
+    const LineOrigin& origin = output.origins[index];
+    if (needsLineDirective((index == 0) ? nullptr : &output.lines[index - 1],
+      (index == 0) ? nullptr : &output.origins[index - 1], origin))
+    {
+      result.lines.push_back(lineDirective(origin));
+      result.origins.push_back(LineOrigin{NO_SOURCE, 0});
+    }
+    result.lines.push_back(output.lines[index]);
+    result.origins.push_back(origin);
+  }
+  output = move(result);
+}
+bool Tangler::hasLineDirectives(const string& fileName) const
+{
+  string extension;
+  size_t dot = fileName.rfind(".");
+  if (dot != string::npos)
+  {
+    extension = fileName.substr(dot);
+  }
+  return lineDirectives &&
+    (string(C_EXTENSIONS).find(" " + extension + " ") != string::npos);
+}
+
+bool Tangler::needsLineDirective(const string* previousLine,
+  const LineOrigin* previousOrigin, const LineOrigin& origin) const
+{
+  bool jump = (previousOrigin == nullptr) ||
+    (origin.source != previousOrigin->source) ||
+    (origin.line != previousOrigin->line + 1);
+  bool continued = (previousLine != nullptr) && !previousLine->empty() &&
+    (previousLine->back() == '\\');
+  return jump && !continued && (origin.source < sourcePaths.size());
+}
+
+string Tangler::lineDirective(const LineOrigin& origin) const
+{
+  return "#line " + to_string(origin.line + 1) + " \"" +
+    sourcePaths[origin.source] + "\"";
+}
@@ -1,20 +1,94 @@
 #pragma once
 
-#include <map>
+#include <functional>
+#include <mutex>
+#include <ostream>
 #include <string>
-#include "CodeBlock.h"
-#include "FileBlock.h"
+#include <unordered_map>
+#include <vector>
+#include "BlockStore.h"
+#include "Estimator.h"
+#include "LineGenerator.h"
+#include "Manifest.h"
+#include "OutputCache.h"
+#include "Parser.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+
+struct TangledBlock
+{
+  std::vector<std::string> lines;
+  std::vector<LineOrigin> origins;
+};
 
 class Tangler
 {
 public:
-  bool tangle(std::map<std::string, FileBlock*> fileBlocks,
-    std::map<std::string, CodeBlock*> codeBlocks, std::string outputDirectory);
+  void setProvenance(const std::vector<Source>& sources,
+    const std::vector<std::string>& importedPaths, bool sourceMaps,
+    bool lineDirectives);
+  void setProfiler(Profiler* profiler);
+  void setCache(OutputCache* cache);
+  void setEstimator(const Estimator* estimator);
+  void setScheduler(Scheduler* scheduler);
+  bool tangle(const BlockStore& blocks, std::string outputDirectory,
+    Manifest* manifest = nullptr);
+  bool tangleToStream(const BlockStore& blocks, std::string fileName,
+    std::ostream& stream);
+  bool tangleToArchive(const BlockStore& blocks, std::ostream& stream);
+  bool tangleReady(const BlockStore& blocks,
+    const std::function<bool(const std::string&)>& isFinal,
+    const std::vector<std::string>* settledNames, std::string outputDirectory,
+    Manifest* manifest = nullptr);
+  bool verify(const BlockStore& blocks, std::string outputDirectory);
+  bool preview(const BlockStore& blocks, std::string name, uint32_t lineCount,
+    std::ostream& stream);
+  bool expandCodeBlocks(const BlockStore& blocks,
+    std::vector<const TangledBlock*>& expanded);
 
 private:
-  // TODO: Keep the output as an array of lines
-  bool tangleBlock(Block* block, std::map<std::string, CodeBlock*> codeBlocks,
-    std::vector<std::string>& output);
+  bool tangleFiles(const BlockStore& blocks,
+    std::vector<TangledBlock>& outputFiles);
+  bool tangleBlock(const Block* block, const BlockStore& blocks,
+    TangledBlock& output);
+  void reserveLines(uint32_t node, TangledBlock& output) const;
+  bool canExpandInParallel() const;
+  bool tangleWaves(const BlockStore& blocks,
+    const std::vector<uint8_t>* needed);
+  void forEach(size_t count, const std::function<void(size_t)>& body);
+  bool isClosureFinal(const Block* block, const BlockStore& blocks,
+    const std::function<bool(const std::string&)>& isFinal,
+    std::string* missing = nullptr);
+  bool writeFile(const FileBlock& fileBlock, TangledBlock& output,
+    const std::string& outputDirectory, Manifest* manifest);
+  bool writeOutput(const FileBlock& fileBlock, const std::string& outputString,
+    const std::string& cachedPath, const std::string& outputPath,
+    Manifest* manifest);
+  bool tangleCached(const BlockStore& blocks, std::string outputDirectory,
+    Manifest* manifest);
+  bool expandFile(const FileBlock& fileBlock, const BlockStore& blocks,
+    std::string& outputString);
+  bool generateLines(LineGenerator& generator, bool directives,
+    const std::function<bool(const std::string&)>& consume);
+  void addLineDirectives(std::string fileName, TangledBlock& output);
+  bool hasLineDirectives(const std::string& fileName) const;
+  bool needsLineDirective(const std::string* previousLine,
+    const LineOrigin* previousOrigin, const LineOrigin& origin) const;
+  std::string lineDirective(const LineOrigin& origin) const;
 
-  std::map<std::string, std::vector<std::string>> tangledBlocks;
+  std::vector<TangledBlock> tangledBlocks;
+  std::vector<bool> isTangled;
+  std::vector<bool> isExpanding;
+  std::vector<bool> isClosureKnown;
+  std::unordered_map<std::string, std::vector<uint32_t>> waitingFiles;
+  uint32_t readyCheckedCount = 0;
+  std::vector<std::string> sourcePaths;
+  size_t sourceCount = 0;
+  bool sourceMaps = false;
+  bool lineDirectives = false;
+  Profiler* profiler = nullptr;
+  OutputCache* cache = nullptr;
+  const Estimator* estimator = nullptr;
+  Scheduler* scheduler = nullptr;
+  std::mutex manifestMutex;
 };
@@ -0,0 +1,549 @@
+#include "Weaver.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#if defined(__linux__) || defined(__APPLE__)
+  #include <unistd.h>
+#elif _WIN32
+  #include "Windows.h"
+#endif
+using namespace std;
+
+Weaver::Weaver(Scheduler& renderScheduler) :
+  scheduler(renderScheduler)
+{
+}
+bool Weaver::weave(const vector<Source>& sources,
+  const BlockStore& blocks, string outputDirectory)
+{
+  indexBlocks(blocks);
+  vector<string> pages(sources.size());
+  scheduler.parallelFor(sources.size(), [&](size_t sourceIndex)
+  {
+    if (sources[sourceIndex].found)
+    {
+      pages[sourceIndex] = renderSource(sources[sourceIndex]);
+    }
+  });
+  if (outputDirectory.back() != '/')
+  {
+    outputDirectory += "/";
+  }
+  string rootDirectory;
+  if (!sources.empty())
+  {
+    size_t separator = sources[0].path.rfind("/");
+    if (separator != string::npos)
+    {
+      rootDirectory = sources[0].path.substr(0, separator + 1);
+    }
+  }
+  vector<string> pagePaths(sources.size());
+  for (size_t index = 0; index < sources.size(); ++index)
+  {
+    if (!sources[index].found)
+    {
+      continue;
+    }
+    pagePaths[index] = htmlPath(relativePath(rootDirectory,
+      sources[index].path));
+    if ((pagePaths[index].rfind("..", 0) == 0) ||
+      (pagePaths[index].front() == '/'))
+    {
+      cout << "Error: Source '" << sources[index].path <<
+        "' is outside the directory of the root source." << endl;
+      return false;
+    }
+  }
+  for (size_t index = 0; index < sources.size(); ++index)
+  {
+    if (!sources[index].found)
+    {
+      continue;
+    }
+    string outputPath = outputDirectory + pagePaths[index];
+    size_t position = outputPath.find("/", 0);
+    while (position != string::npos)
+    {
+      string directory = outputPath.substr(0, position);
+      struct stat st;
+      if (stat(directory.c_str(), &st) != 0)
+      {
+    #if defined(__linux__) || defined(__APPLE__)
+        if ((mkdir(directory.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
+          S_IROTH | S_IXOTH) != 0) && (errno != EEXIST))
+    #elif _WIN32
+        if (!CreateDirectoryA(directory.c_str(), NULL) &&
+          (GetLastError() != ERROR_ALREADY_EXISTS))
+    #endif
+        {
+          cout << "Error: Failed to create directory '" << directory <<
+            "'." << endl;
+          return false;
+        }
+      }
+      else if (!(st.st_mode & S_IFDIR))
+      {
+        cout << "Error: Cannot create directory '" << directory <<
+          "' because a file exists with the same name." << endl;
+        return false;
+      }
+      position = outputPath.find("/", position + 1);
+    }
+    ofstream outStream(outputPath);
+    outStream << pages[index];
+    outStream.close();
+    if (!outStream.good())
+    {
+      cout << "Error: Failed to write '" << outputPath << "'." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+void Weaver::indexBlocks(const BlockStore& blocks)
+{
+  const vector<FileBlock>& fileBlocks = blocks.getFileBlocks();
+  const vector<CodeBlock>& codeBlocks = blocks.getCodeBlocks();
+  uint32_t count = 0;
+  for (auto it = fileBlocks.begin(); it != fileBlocks.end(); ++it)
+  {
+    Entry& entry = fileEntries[it->getName()];
+    entry.name = it->getName();
+    entry.id = "block" + to_string(count++);
+    entry.isFile = true;
+    entry.block = &*it;
+  }
+  for (auto it = codeBlocks.begin(); it != codeBlocks.end(); ++it)
+  {
+    Entry& entry = codeEntries[it->getName()];
+    entry.name = it->getName();
+    entry.id = "block" + to_string(count++);
+    entry.isFile = false;
+    entry.block = &*it;
+    entry.appendSources = it->getAppendSources();
+  }
+  vector<const Entry*> parents;
+  for (auto it = fileBlocks.begin(); it != fileBlocks.end(); ++it)
+  {
+    parents.push_back(&fileEntries[it->getName()]);
+  }
+  for (auto it = codeBlocks.begin(); it != codeBlocks.end(); ++it)
+  {
+    parents.push_back(&codeEntries[it->getName()]);
+  }
+  for (auto parentIt = parents.begin(); parentIt != parents.end(); ++parentIt)
+  {
+    const vector<string>& lines = (*parentIt)->block->getLines();
+    for (auto lineIt = lines.begin(); lineIt != lines.end(); ++lineIt)
+    {
+      string whitespace, name;
+      if (!Block::parseReference(*lineIt, whitespace, name))
+      {
+        continue;
+      }
+      auto child = codeEntries.find(name);
+      if ((child != codeEntries.end()) && (child->second.usedBy.empty() ||
+        (child->second.usedBy.back() != *parentIt)))
+      {
+        child->second.usedBy.push_back(*parentIt);
+      }
+    }
+  }
+}
+
+string Weaver::renderSource(const Source& source)
+{
+  const vector<string>& lines = source.lines;
+  stringstream html;
+  string paragraph, container;
+  html << "<!DOCTYPE html>" << endl;
+  html << "<html>" << endl << "<head>" << endl;
+  html << "<meta charset=\"utf-8\">" << endl;
+  html << "<title>" << escape(source.path) << "</title>" << endl;
+  html << "<style>" << endl;
+  html << "body { max-width: 60em; margin: auto; padding: 1em; " <<
+    "font-family: sans-serif; line-height: 1.4; }" << endl;
+  html << "pre { background: #f6f8fa; padding: 0.5em; overflow-x: auto; }" <<
+    endl;
+  html << ".block { margin: 1em 0; }" << endl;
+  html << ".header { font-weight: bold; font-family: monospace; }" << endl;
+  html << ".references { font-size: 0.85em; color: #555; }" << endl;
+  html << "</style>" << endl;
+  html << "</head>" << endl << "<body>" << endl;
+  for (uint32_t lineNumber = 0; lineNumber < lines.size(); ++lineNumber)
+  {
+    const string& line = lines[lineNumber];
+    if ((lineNumber + 1) < lines.size())
+    {
+      const string& nextLine = lines[lineNumber + 1];
+      const Entry* entry = nullptr;
+      if (FileBlock::checkStart(line, nextLine))
+      {
+        FileBlock header(source.path, lineNumber);
+        header.parseHeader(line);
+        auto it = fileEntries.find(header.getName());
+        entry = (it == fileEntries.end()) ? nullptr : &it->second;
+      }
+      else if (CodeBlock::checkStart(line, nextLine))
+      {
+        CodeBlock header(source.path, lineNumber);
+        header.parseHeader(line);
+        auto it = codeEntries.find(header.getName());
+        entry = (it == codeEntries.end()) ? nullptr : &it->second;
+      }
+      if (entry != nullptr)
+      {
+        closeElements(html, paragraph, container);
+        bool definition = ((entry->block->getSourceFile() == source.path) &&
+          (entry->block->getSourceLine() == lineNumber));
+        string anchor = entry->id;
+        for (size_t index = 0; !definition &&
+          (index < entry->appendSources.size()); ++index)
+        {
+          if ((entry->appendSources[index].first == source.path) &&
+            (entry->appendSources[index].second == lineNumber))
+          {
+            anchor += "-" + to_string(index);
+          }
+        }
+        html << "<div class=\"block\" id=\"" << anchor << "\">" << endl;
+        html << "<div class=\"header\">" << (entry->isFile ? "File " : "") <<
+          "&laquo;" << escape(entry->name) << "&raquo;" <<
+          (definition ? "" : " +=") << "</div>" << endl;
+        html << "<pre><code>";
+        lineNumber += 2;
+        while ((lineNumber < lines.size()) &&
+          !entry->block->checkEnd(lines[lineNumber]))
+        {
+          string whitespace, name;
+          auto child = codeEntries.end();
+          if (Block::parseReference(lines[lineNumber], whitespace, name))
+          {
+            child = codeEntries.find(name);
+          }
+          if (child != codeEntries.end())
+          {
+            html << escape(whitespace) << "@{<a href=\"" <<
+              linkTo(&child->second, source.path) << "\">" << escape(name) <<
+              "</a>}" << endl;
+          }
+          else
+          {
+            html << escape(lines[lineNumber]) << endl;
+          }
+          lineNumber += 1;
+        }
+        html << "</code></pre>" << endl;
+        html << renderReferences(entry, definition, source.path);
+        html << "</div>" << endl;
+        continue;
+      }
+    }
+    if (line.rfind("```", 0) == 0)
+    {
+      closeElements(html, paragraph, container);
+      string fence = line.substr(0, line.find_first_not_of('`'));
+      html << "<pre><code>";
+      while (++lineNumber < lines.size())
+      {
+        const string& codeLine = lines[lineNumber];
+        if ((codeLine.rfind(fence, 0) == 0) &&
+          (codeLine.find_first_not_of('`') == string::npos))
+        {
+          break;
+        }
+        html << escape(codeLine) << endl;
+      }
+      html << "</code></pre>" << endl;
+      continue;
+    }
+    if (line.find_first_not_of(" \t") == string::npos)
+    {
+      closeElements(html, paragraph, container);
+      continue;
+    }
+    size_t level = line.find_first_not_of('#');
+    if ((level >= 1) && (level <= 6) && (line[level] == ' '))
+    {
+      closeElements(html, paragraph, container);
+      html << "<h" << level << ">" << renderInline(line.substr(level + 1)) <<
+        "</h" << level << ">" << endl;
+      continue;
+    }
+    if (line[0] == '<')
+    {
+      closeElements(html, paragraph, container);
+      html << line << endl;
+      continue;
+    }
+    string tag;
+    size_t textStart = 0;
+    if ((line.rfind("- ", 0) == 0) || (line.rfind("* ", 0) == 0))
+    {
+      tag = "ul";
+      textStart = 2;
+    }
+    else
+    {
+      size_t digits = line.find_first_not_of("0123456789");
+      if ((digits != string::npos) && (digits > 0) &&
+        (line.compare(digits, 2, ". ") == 0))
+      {
+        tag = "ol";
+        textStart = digits + 2;
+      }
+    }
+    if (!tag.empty())
+    {
+      if (container != tag)
+      {
+        closeElements(html, paragraph, container);
+        html << "<" << tag << ">" << endl;
+        container = tag;
+      }
+      flushParagraph(html, paragraph, container);
+      paragraph = line.substr(textStart);
+      continue;
+    }
+    if (line[0] == '>')
+    {
+      if (container != "blockquote")
+      {
+        closeElements(html, paragraph, container);
+        html << "<blockquote>" << endl;
+        container = "blockquote";
+      }
+      size_t textIndex = line.find_first_not_of(' ', 1);
+      if (textIndex != string::npos)
+      {
+        paragraph += (paragraph.empty() ? "" : " ") + line.substr(textIndex);
+      }
+      continue;
+    }
+    if (!container.empty() && ((container == "blockquote") || (line[0] != ' ')))
+    {
+      closeElements(html, paragraph, container);
+    }
+    size_t textIndex = line.find_first_not_of(' ');
+    paragraph += (paragraph.empty() ? "" : " ") + line.substr(textIndex);
+  }
+  closeElements(html, paragraph, container);
+  html << "</body>" << endl << "</html>" << endl;
+  return html.str();
+}
+void Weaver::closeElements(ostream& html, string& paragraph,
+  string& container)
+{
+  flushParagraph(html, paragraph, container);
+  if (!container.empty())
+  {
+    html << "</" << container << ">" << endl;
+    container.clear();
+  }
+}
+void Weaver::flushParagraph(ostream& html, string& paragraph,
+  const string& container)
+{
+  if (!paragraph.empty())
+  {
+    bool listItem = ((container == "ul") || (container == "ol"));
+    html << (listItem ? "<li>" : "<p>") << renderInline(paragraph) <<
+      (listItem ? "</li>" : "</p>") << endl;
+    paragraph.clear();
+  }
+}
+string Weaver::renderReferences(const Entry* entry, bool definition,
+  const string& sourcePath)
+{
+  string html = "<div class=\"references\">";
+  if (!definition)
+  {
+    html += "Appends to <a href=\"" + linkTo(entry, sourcePath) + "\">" +
+      escape(entry->name) + "</a>.";
+  }
+  else
+  {
+    if (!entry->appendSources.empty())
+    {
+      html += "Appended in";
+      for (size_t index = 0; index < entry->appendSources.size(); ++index)
+      {
+        string file = entry->appendSources[index].first;
+        string target = htmlPath(file);
+        string link = (file == sourcePath) ? "" :
+          relativePath(htmlPath(sourcePath), target);
+        html += string((index == 0) ? " " : ", ") + "<a href=\"" + link + "#" +
+          entry->id + "-" + to_string(index) + "\">" + escape(file) + "</a>";
+      }
+      html += ". ";
+    }
+    if (!entry->usedBy.empty())
+    {
+      html += "Used by";
+      for (auto it = entry->usedBy.begin(); it != entry->usedBy.end(); ++it)
+      {
+        html += string((it == entry->usedBy.begin()) ? " " : ", ") +
+          "<a href=\"" + linkTo(*it, sourcePath) + "\">" + escape((*it)->name) +
+          "</a>";
+      }
+      html += ".";
+    }
+    else if (!entry->isFile)
+    {
+      html += "Never used.";
+    }
+  }
+  return html + "</div>\n";
+}
+string Weaver::renderInline(const string& text)
+{
+  string html;
+  size_t index = 0;
+  while (index < text.size())
+  {
+    char c = text[index];
+    if ((c == '\\') && ((index + 1) < text.size()) &&
+      ispunct(static_cast<unsigned char>(text[index + 1])))
+    {
+      html += escape(string(1, text[index + 1]));
+      index += 2;
+      continue;
+    }
+    if (c == '`')
+    {
+      size_t codeStart = text.find_first_not_of('`', index);
+      if (codeStart != string::npos)
+      {
+        string delimiter = text.substr(index, codeStart - index);
+        size_t codeEnd = text.find(delimiter, codeStart);
+        if (codeEnd != string::npos)
+        {
+          string code = text.substr(codeStart, codeEnd - codeStart);
+          if ((code.size() > 2) && (code.front() == ' ') && (code.back() == ' '))
+          {
+            code = code.substr(1, code.size() - 2);
+          }
+          html += "<code>" + escape(code) + "</code>";
+          index = codeEnd + delimiter.size();
+          continue;
+        }
+      }
+    }
+    if (c == '*')
+    {
+      string delimiter = (text.compare(index, 2, "**") == 0) ? "**" : "*";
+      size_t emphasisEnd = text.find(delimiter, index + delimiter.size());
+      if (emphasisEnd != string::npos)
+      {
+        string tag = (delimiter.size() == 2) ? "strong" : "em";
+        html += "<" + tag + ">" + renderInline(text.substr(index +
+          delimiter.size(), emphasisEnd - index - delimiter.size())) + "</" +
+          tag + ">";
+        index = emphasisEnd + delimiter.size();
+        continue;
+      }
+    }
+    bool image = ((c == '!') && (text.compare(index, 2, "![") == 0));
+    if ((c == '[') || image)
+    {
+      size_t labelStart = index + (image ? 2 : 1);
+      size_t labelEnd = text.find("](", labelStart);
+      size_t urlEnd = (labelEnd == string::npos) ? string::npos :
+        text.find(')', labelEnd + 2);
+      if ((urlEnd != string::npos) && (text.find(']', labelStart) == labelEnd))
+      {
+        string label = text.substr(labelStart, labelEnd - labelStart);
+        string url = text.substr(labelEnd + 2, urlEnd - labelEnd - 2);
+        if (image)
+        {
+          html += "<img src=\"" + escape(url) + "\" alt=\"" + escape(label) +
+            "\" />";
+        }
+        else
+        {
+          if ((url.find("://") == string::npos) && (url.size() > 3) &&
+            (url.compare(url.size() - 3, 3, ".md") == 0))
+          {
+            url = htmlPath(url);
+          }
+          html += "<a href=\"" + escape(url) + "\">" + renderInline(label) +
+            "</a>";
+        }
+        index = urlEnd + 1;
+        continue;
+      }
+    }
+    html += escape(string(1, c));
+    index += 1;
+  }
+  return html;
+}
+
+string Weaver::linkTo(const Entry* entry, const string& sourcePath)
+{
+  string file = entry->block->getSourceFile();
+  if (file == sourcePath)
+  {
+    return "#" + entry->id;
+  }
+  return relativePath(htmlPath(sourcePath), htmlPath(file)) + "#" +
+    entry->id;
+}
+string Weaver::htmlPath(string path)
+{
+  if (path == "-")
+  {
+    return "stdin.html";
+  }
+  if ((path.size() > 3) && (path.compare(path.size() - 3, 3, ".md") == 0))
+  {
+    path = path.substr(0, path.size() - 3);
+  }
+  return path + ".html";
+}
+string Weaver::relativePath(string from, string to)
+{
+  size_t common = 0;
+  size_t index = 0;
+  while ((index < from.size()) && (index < to.size()) &&
+    (from[index] == to[index]))
+  {
+    if (from[index] == '/')
+    {
+      common = index + 1;
+    }
+    index += 1;
+  }
+  string relative;
+  for (index = common; index < from.size(); ++index)
+  {
+    if (from[index] == '/')
+    {
+      relative += "../";
+    }
+  }
+  return relative + to.substr(common);
+}
+string Weaver::escape(const string& text)
+{
+  string escaped;
+  escaped.reserve(text.size());
+  for (auto it = text.begin(); it != text.end(); ++it)
+  {
+    switch (*it)
+    {
+    case '&': escaped += "&amp;"; break;
+    case '<': escaped += "&lt;"; break;
+    case '>': escaped += "&gt;"; break;
+    case '"': escaped += "&quot;"; break;
+    default: escaped += *it; break;
+    }
+  }
+  return escaped;
+}
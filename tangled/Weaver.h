@@ -0,0 +1,48 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BlockStore.h"
+#include "Parser.h"
+#include "Scheduler.h"
+
+class Weaver
+{
+public:
+  Weaver(Scheduler& scheduler);
+
+public:
+  bool weave(const std::vector<Source>& sources,
+    const BlockStore& blocks, std::string outputDirectory);
+
+private:
+  struct Entry
+  {
+    std::string name;
+    std::string id;
+    bool isFile;
+    const Block* block;
+    std::vector<std::pair<std::string, uint32_t>> appendSources;
+    std::vector<const Entry*> usedBy;
+  };
+
+  void indexBlocks(const BlockStore& blocks);
+  std::string renderSource(const Source& source);
+  void closeElements(std::ostream& html, std::string& paragraph,
+    std::string& container);
+  void flushParagraph(std::ostream& html, std::string& paragraph,
+    const std::string& container);
+  std::string renderReferences(const Entry* entry, bool definition,
+    const std::string& sourcePath);
+  std::string renderInline(const std::string& text);
+  std::string linkTo(const Entry* entry, const std::string& sourcePath);
+  static std::string htmlPath(std::string path);
+  static std::string relativePath(std::string from, std::string to);
+  static std::string escape(const std::string& text);
+
+  Scheduler& scheduler;
+  std::unordered_map<std::string, Entry> fileEntries;
+  std::unordered_map<std::string, Entry> codeEntries;
+};